@@ -20,18 +20,23 @@
 
 #include <glib.h>
 #include <gio/gio.h>
+#include <unistd.h>
 
 BrowserController::BrowserController(BrowserInterface *impl,
                                      std::shared_ptr<LaunchConfigInterface> launchConfig,
-                                     std::string &&packageUrl)
+                                     std::string &&packageUrl,
+                                     bool prewarm)
     : m_browser(impl)
     , m_launchConfig(launchConfig)
     , m_packageUrl(std::move(packageUrl))
+    , m_prewarm(prewarm)
 {
 }
 
 BrowserController::~BrowserController()
 {
+    if (m_launchRequestWatch)
+        g_source_remove(m_launchRequestWatch);
 }
 
 // Called at start-up from the main event loop - should start the browser
@@ -42,6 +47,7 @@ void BrowserController::launch()
 
     // connect callbacks
     m_browser->onLaunched.connect(std::bind(&BrowserController::onBrowserLaunched, this));
+    m_browser->onPreloaded.connect(std::bind(&BrowserController::onBrowserPreloaded, this));
     m_browser->onClose.connect(std::bind(&BrowserController::onBrowserClose, this, std::placeholders::_1));
 
     // launch the browser
@@ -51,8 +57,18 @@ void BrowserController::launch()
         return;
     }
 
+    // a pre-warmed browser only connects once it got adopted by a launch
+    if (!m_prewarm)
+    {
+        connectFirebolt();
+    }
+}
+
+void BrowserController::connectFirebolt()
+{
     if (auto fireboltEndpoint = m_launchConfig->fireboltEndpoint(); !fireboltEndpoint.empty())
     {
+        StartupTrace::begin(StartupPhase::FireboltConnect);
         Firebolt::Config cfg {
             .wsUrl = fireboltEndpoint,
             #ifndef NDEBUG
@@ -67,6 +83,7 @@ void BrowserController::launch()
                 g_message("Firebolt disconnected, code = %d", code);
                 return;
             }
+            StartupTrace::end(StartupPhase::FireboltConnect);
             if (!m_connectJob.joinable())
             {
                 m_connectJob = std::jthread(std::bind(&BrowserController::onFireboltConnected, this));
@@ -91,6 +108,13 @@ void BrowserController::onBrowserLaunched()
 
     g_message("Browser launched");
 
+    if (m_prewarm)
+    {
+        g_message("Pre-warming browser");
+        m_browser->preload();
+        return;
+    }
+
     m_browser->navigateTo(m_packageUrl);
 
     if (m_launchConfig->fireboltEndpoint().empty())
@@ -99,6 +123,74 @@ void BrowserController::onBrowserLaunched()
     }
 }
 
+// Called once about:blank is committed in pre-warm mode. The browser stays
+// parked until the package url of the launch to adopt is written to stdin.
+void BrowserController::onBrowserPreloaded()
+{
+    g_assert(g_main_context_is_owner (g_main_context_default()));
+
+    g_message("Browser pre-warmed, waiting for launch request");
+
+    GIOChannel *channel = g_io_channel_unix_new(STDIN_FILENO);
+
+    // a partial line must not block the main loop, it stays buffered in the
+    // channel until the rest of it arrives
+    GError *error = nullptr;
+    if (g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, &error) != G_IO_STATUS_NORMAL)
+    {
+        g_warning("cannot make the launch request channel non-blocking: %s", error ? error->message : "unknown");
+        g_clear_error(&error);
+    }
+
+    m_launchRequestWatch = g_io_add_watch(
+        channel,
+        static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR),
+        [](GIOChannel *channel, GIOCondition condition, gpointer userData) -> gboolean {
+            auto *self = reinterpret_cast<BrowserController*>(userData);
+            GIOStatus status = G_IO_STATUS_ERROR;
+
+            if (condition & (G_IO_IN | G_IO_HUP))
+            {
+                gchar *line = nullptr;
+
+                // more than one line can be buffered, skip the empty ones
+                while ((status = g_io_channel_read_line(channel, &line, nullptr, nullptr, nullptr)) == G_IO_STATUS_NORMAL)
+                {
+                    std::string packageUrl { g_strstrip(line) };
+                    g_free(line);
+
+                    if (!packageUrl.empty())
+                    {
+                        self->m_launchRequestWatch = 0;
+                        self->adopt(std::move(packageUrl));
+                        return G_SOURCE_REMOVE;
+                    }
+                }
+            }
+
+            if (status == G_IO_STATUS_AGAIN)
+                return G_SOURCE_CONTINUE;
+
+            g_message("launch request channel closed while pre-warmed");
+            self->m_launchRequestWatch = 0;
+            self->close();
+            return G_SOURCE_REMOVE;
+        },
+        this);
+    g_io_channel_unref(channel);
+}
+
+void BrowserController::adopt(std::string &&packageUrl)
+{
+    g_message("Adopting launch of %s", packageUrl.c_str());
+
+    m_prewarm = false;
+    m_packageUrl = std::move(packageUrl);
+
+    connectFirebolt();
+    onBrowserLaunched();
+}
+
 void BrowserController::onFireboltConnected()
 {
     using namespace Firebolt;
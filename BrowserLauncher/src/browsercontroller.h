@@ -31,7 +31,8 @@ class BrowserController
 public:
     BrowserController(BrowserInterface *impl,
                       std::shared_ptr<LaunchConfigInterface> launchConfig,
-                      std::string &&packageUrl);
+                      std::string &&packageUrl,
+                      bool prewarm = false);
 
     ~BrowserController();
 
@@ -40,6 +41,9 @@ public:
 
 private:
     void onBrowserLaunched();
+    void onBrowserPreloaded();
+    void adopt(std::string &&packageUrl);
+    void connectFirebolt();
     void onFireboltConnected();
     void onBrowserClose(CloseReason);
     void onLifecycleStateChanged(std::vector<Firebolt::Lifecycle::StateChange>);
@@ -49,6 +53,8 @@ private:
     BrowserInterface * const m_browser;
     std::shared_ptr<LaunchConfigInterface> m_launchConfig;
     std::string m_packageUrl;
+    bool m_prewarm;
+    unsigned m_launchRequestWatch { 0 };
 
     bool m_isFocused { false };
     Firebolt::Lifecycle::LifecycleState m_lifecycleState { Firebolt::Lifecycle::LifecycleState::INITIALIZING };
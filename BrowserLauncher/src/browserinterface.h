@@ -23,6 +23,7 @@
 
 #include "launchconfiginterface.h"
 #include "simplesignalslot.h"
+#include "startuptrace.h"
 
 enum class CloseReason : uint8_t
 {
@@ -55,6 +56,10 @@ public:
     // Request loading of the specified web app
     virtual void navigateTo(const std::string &url) = 0;
 
+    // Commit about:blank, so the web process is spawned and initialized before
+    // the web app url is known
+    virtual void preload() = 0;
+
     // Change the lifecycle state of the web page
     virtual bool setState(PageLifecycleState state) = 0;
 
@@ -67,8 +72,14 @@ public:
     // Notifies that browser launched and ready to load url
     Signal<> onLaunched;
 
+    // Notifies that preload completed and browser is parked on about:blank
+    Signal<> onPreloaded;
+
     // Notifies that browser needs to be closed (or concealed)
     Signal<CloseReason> onClose;
+
+    // Launch phase trace of the launcher, set before launch()
+    StartupTrace *startupTrace { nullptr };
 };
 
 // Factory function to instantiate browser instance
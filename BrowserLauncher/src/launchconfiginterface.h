@@ -58,6 +58,8 @@ public:
     virtual std::vector<LocalFilePath> userStyleSheets() const = 0;
     virtual std::vector<LocalFilePath> browserExtensions() const = 0;
     virtual int maxUnresponsiveTimeMs() const = 0;
+    virtual int hangCheckIntervalMs() const = 0;
+    virtual int idleHangCheckIntervalMs() const = 0;
     virtual bool isHeadless() const = 0;
     virtual bool enableGpuMemLimiting() const = 0;
     virtual std::string customUserAgentBase() const = 0;
@@ -72,4 +74,5 @@ public:
     virtual bool enableLifecycle2() const = 0;
     virtual bool memoryMonitorUseContainerMode() const = 0;
     virtual bool opportunisticSweepingAndGC() const = 0;
+    virtual std::string startupTraceFile() const = 0;
 };
@@ -35,6 +35,8 @@
     macro(std::vector<LocalFilePath>, userScripts, {}, "User scripts to inject into the browser.") \
     macro(std::vector<LocalFilePath>, userStyleSheets, {}, "User styles to inject into the browser.") \
     macro(int, maxUnresponsiveTimeMs, {60*1000}, "Browser watchdog timeout.") \
+    macro(int, hangCheckIntervalMs, {5*1000}, "Browser watchdog probe interval while the page is active.") \
+    macro(int, idleHangCheckIntervalMs, {30*1000}, "Browser watchdog probe interval while the page is hidden or frozen.") \
     macro(bool, isHeadless, {false}, "Enable 'headless' mode.")          \
     macro(bool, enableGpuMemLimiting, {true}, "Enable GPU memory monitoring.") \
     macro(std::string, customUserAgent, {}, "Override browser user agent.") \
@@ -51,6 +53,7 @@
     macro(bool, enableLifecycle2, {true}, "Enable page lifecycle.") \
     macro(bool, memoryMonitorUseContainerMode, {true}, "Enable memory monitor usage in container mode." ) \
     macro(bool, opportunisticSweepingAndGC, {true}, "Enable opportunistic sweeping and garbage collection.") \
+    macro(std::string, startupTraceFile, {}, "Write the launch phase timings as Chrome trace-event JSON to this file on exit, instead of logging them.") \
 
 //
 // configuration options set via envs or container environment
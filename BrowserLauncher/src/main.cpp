@@ -19,6 +19,7 @@
 #include "browserinterface.h"
 #include "browsercontroller.h"
 #include "launchconfig.h"
+#include "startuptrace.h"
 
 #include <glib-unix.h>
 #include <glib.h>
@@ -37,6 +38,10 @@ struct GFreeDeleter
 
 using gchar_ptr = std::unique_ptr<gchar, GFreeDeleter>;
 
+// launch phase timings, dumped on exit or when terminated by a signal
+static StartupTrace startupTrace;
+static std::string startupTraceFile;
+
 static bool preLoadLib(const char *pattern)
 {
     glob_t globBuf;
@@ -185,14 +190,18 @@ int main(int argc, char *argv[])
     GError *error = nullptr;
     gchar *url = nullptr;
     gchar *configPath = nullptr;
+    gboolean prewarm = FALSE;
     std::map<std::string, std::string> configOptions;
 
+    StartupTrace::install(&startupTrace);
+
     // parse arguments
     {
         GOptionContext *context;
         GOptionEntry entries[] = {
             { "url", 'u', 0, G_OPTION_ARG_STRING, &url, "Package uri", "file://" DEFAULT_LOCAL_FILE_DIR "/index.html" },
             { "config", 'c', 0, G_OPTION_ARG_STRING, &configPath, "Config path", DEFAULT_LOCAL_FILE_DIR "/rdk.config" },
+            { "prewarm", 'p', 0, G_OPTION_ARG_NONE, &prewarm, "Park on about:blank and read the package uri to launch from stdin", nullptr },
             { nullptr }
         };
         context = g_option_context_new (nullptr);
@@ -205,13 +214,16 @@ int main(int argc, char *argv[])
             return EXIT_FAILURE;
         }
         g_option_context_free (context);
-        if (!url)
+        if (!url && !prewarm)
             url = g_strdup("file://" DEFAULT_LOCAL_FILE_DIR "/index.html");
         if (!configPath)
             configPath = g_strdup(DEFAULT_LOCAL_FILE_DIR "/rdk.config");
     }
 
-    g_message("starting BrowserLauncher v" BROWSER_LAUNCHER_VERSION ", package url %s", url);
+    if (prewarm)
+        g_message("starting BrowserLauncher v" BROWSER_LAUNCHER_VERSION " pre-warmed");
+    else
+        g_message("starting BrowserLauncher v" BROWSER_LAUNCHER_VERSION ", package url %s", url);
 
     GApplication* application = g_application_new("org.rdk.BrowserLauncher", G_APPLICATION_NON_UNIQUE);
 
@@ -223,6 +235,7 @@ int main(int argc, char *argv[])
             signum,
             [](gpointer userData) {
                 g_message("got signal %d", GPOINTER_TO_INT(userData));
+                startupTrace.dump(startupTraceFile);
                 GApplication* application = g_application_get_default();
                 BrowserController* controller =
                     reinterpret_cast<BrowserController*> (g_object_get_data(G_OBJECT(application), "browsercontroller"));
@@ -235,18 +248,26 @@ int main(int argc, char *argv[])
 
     // process the launch config (rdk.config and environment variables), we do
     // this early primarily so can determine if headless mode or not
+    StartupTrace::begin(StartupPhase::ParseConfig);
     auto launchconfig = LaunchConfig::create(configPath ?: "");
     launchconfig->applyCmdLineOptions(std::move(configOptions));
+    StartupTrace::end(StartupPhase::ParseConfig);
     launchconfig->printConfig();
+    startupTraceFile = launchconfig->startupTraceFile();
 
     // preload dependencies
+    StartupTrace::begin(StartupPhase::PreloadWPE);
     preLoadWPE(launchconfig->runtimeDir());
+    StartupTrace::end(StartupPhase::PreloadWPE);
 
     // create the browser instance
+    StartupTrace::begin(StartupPhase::CreateBrowserInstance);
     std::unique_ptr<BrowserInterface> browser { createBrowserInstance(launchconfig->runtimeDir()) };
+    StartupTrace::end(StartupPhase::CreateBrowserInstance);
+    browser->startupTrace = &startupTrace;
 
     // create the browser controller
-    BrowserController controller(browser.get(), std::move(launchconfig), std::string(url));
+    BrowserController controller(browser.get(), std::move(launchconfig), std::string(url ?: ""), prewarm);
 
     // launch browser on main event loop
     g_signal_connect(application, "activate", G_CALLBACK(+[](GApplication* application, BrowserController* controller) {
@@ -263,6 +284,8 @@ int main(int argc, char *argv[])
 
     g_object_set_data(G_OBJECT(application), "browsercontroller", nullptr);
 
+    startupTrace.dump(startupTraceFile);
+
     // terminate the browser instance
     browser->dispose();
 
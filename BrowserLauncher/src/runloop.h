@@ -21,67 +21,165 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <optional>
-#include <memory>
 
-// A helper for dispatching c++ callable objects on glib's main loop
+// A helper for dispatching c++ callable objects on glib's main loop.
+//
+// All tasks go through a single GSource that stays attached for the lifetime
+// of the RunLoop: posted tasks land in a mutex protected queue, delayed ones
+// in a deadline ordered map, and the source's ready time is moved so the
+// context wakes up once per batch instead of once per task.
 class RunLoop
 {
 protected:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        bool enabled { true };
+        std::deque<std::function<void()>> pending;
+        std::multimap<gint64, std::function<void()>> delayed;
+
+        // next wakeup in monotonic time, 0 for now and -1 for never, mutex held
+        gint64 readyTime() const
+        {
+            if (!pending.empty())
+                return 0;
+            if (!delayed.empty())
+                return delayed.begin()->first;
+            return -1;
+        }
+    };
+
+    struct TaskSource
+    {
+        GSource base;
+        TaskQueue *queue;
+    };
+
     GMainContext *m_mainContext { nullptr };
-    std::shared_ptr<char> m_token { std::make_shared<char> (37) };
+    GSource *m_source { nullptr };
+    TaskQueue *m_queue { nullptr };
+
+    static gboolean dispatch(GSource *source, GSourceFunc, gpointer)
+    {
+        TaskQueue *queue = reinterpret_cast<TaskSource*>(source)->queue;
+
+        std::deque<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            tasks.swap(queue->pending);
+
+            const gint64 now = g_source_get_time(source);
+            auto due = queue->delayed.begin();
+            while (due != queue->delayed.end() && due->first <= now)
+            {
+                tasks.emplace_back(std::move(due->second));
+                due = queue->delayed.erase(due);
+            }
+
+            g_source_set_ready_time(source, queue->readyTime());
+        }
+
+        for (auto &task : tasks)
+        {
+            {
+                // Disable() / destruction drops whatever is still in flight
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                if (!queue->enabled)
+                    break;
+            }
+            task();
+        }
+
+        return G_SOURCE_CONTINUE;
+    }
+
+    void attach()
+    {
+        static GSourceFuncs sourceFuncs = {
+            nullptr, // prepare
+            nullptr, // check
+            dispatch,
+            [](GSource *source) { // finalize
+                delete reinterpret_cast<TaskSource*>(source)->queue;
+            },
+            nullptr,
+            nullptr
+        };
+
+        m_queue = new TaskQueue;
+        m_source = g_source_new(&sourceFuncs, sizeof(TaskSource));
+        reinterpret_cast<TaskSource*>(m_source)->queue = m_queue;
+        g_source_set_name(m_source, "RunLoop");
+        g_source_set_ready_time(m_source, -1);
+        g_source_attach(m_source, m_mainContext);
+    }
 
 public:
     RunLoop()
         : m_mainContext (g_main_context_ref_thread_default())
     {
+        attach();
     }
 
     explicit RunLoop(GMainContext *context)
         : m_mainContext (g_main_context_ref(context))
     {
+        attach();
     }
 
     ~RunLoop()
     {
+        Disable();
+        g_source_destroy (m_source);
+        g_source_unref (m_source);
         g_main_context_unref (m_mainContext);
     }
 
     void InvokeTask(std::function<void()> && fn, const std::optional<uint32_t> delay = { })
     {
-        if (!m_token)
+        std::unique_lock<std::mutex> lock(m_queue->mutex);
+        if (!m_queue->enabled)
         {
             return;
         }
-        if (g_main_context_is_owner (m_mainContext) && !delay.has_value())
+        if (!delay.has_value() && g_main_context_is_owner (m_mainContext))
         {
+            lock.unlock();
             fn();
             return;
         }
-        struct CallContext
+
+        if (delay.value_or(0) == 0)
         {
-            std::function<void()> fn;
-            std::weak_ptr<char> token_ptr;
-        };
-        GSource *source = g_timeout_source_new (delay.value_or(0));
-        g_source_set_callback (
-            source,
-            G_SOURCE_FUNC(+[](CallContext* ctx) {
-                if (auto token = ctx->token_ptr.lock())
-                    ctx->fn();
-                return G_SOURCE_REMOVE;
-            }),
-            new CallContext(std::move(fn), m_token),
-            reinterpret_cast<GDestroyNotify>(+[](CallContext* ctx) {
-                delete ctx;
-            }));
-        g_source_attach (source, m_mainContext);
-        g_source_unref (source);
+            m_queue->pending.emplace_back(std::move(fn));
+        }
+        else
+        {
+            const gint64 deadline = g_get_monotonic_time() + static_cast<gint64>(delay.value()) * 1000;
+            m_queue->delayed.emplace(deadline, std::move(fn));
+        }
+
+        // only touch the source (and wake up its context) if the next wakeup moved
+        const gint64 readyTime = m_queue->readyTime();
+        if (g_source_get_ready_time(m_source) != readyTime)
+            g_source_set_ready_time(m_source, readyTime);
     }
 
     void Disable()
     {
-        m_token.reset();
+        std::deque<std::function<void()>> pending;
+        std::multimap<gint64, std::function<void()>> delayed;
+        {
+            std::lock_guard<std::mutex> lock(m_queue->mutex);
+            m_queue->enabled = false;
+            pending.swap(m_queue->pending);
+            delayed.swap(m_queue->delayed);
+        }
+        // the dropped tasks are destroyed outside of the lock
     }
 };
@@ -0,0 +1,245 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <glib.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <time.h>
+#include <unistd.h>
+
+// Launch phases, in the order they normally start
+enum class StartupPhase : uint8_t
+{
+    ParseConfig,
+    PreloadWPE,
+    CreateBrowserInstance,
+    WpeWebKitConfig,
+    InitExtensionDir,
+    SetEnvironment,
+    CreateView,
+    FireboltConnect,
+    FirstLoadCommitted,
+    FirstLoadFinished,
+    COUNT
+};
+
+static inline const char* toString(StartupPhase phase)
+{
+#define CASE(x) case StartupPhase::x: return #x
+    switch(phase)
+    {
+        CASE(ParseConfig);
+        CASE(PreloadWPE);
+        CASE(CreateBrowserInstance);
+        CASE(WpeWebKitConfig);
+        CASE(InitExtensionDir);
+        CASE(SetEnvironment);
+        CASE(CreateView);
+        CASE(FireboltConnect);
+        CASE(FirstLoadCommitted);
+        CASE(FirstLoadFinished);
+        case StartupPhase::COUNT: break;
+    }
+#undef CASE
+    return "Unknown";
+}
+
+// Records when each launch phase began and ended on CLOCK_MONOTONIC. Storage
+// is a fixed table with one slot per phase, only the first begin / end of a
+// phase is kept, so recording costs a clock read and an atomic store and is
+// safe from any thread. The table is dumped once, either as a one line report
+// in the log or as Chrome trace-event JSON (chrome://tracing, Perfetto).
+//
+// The launcher owns the instance; the browser backend is a separate module
+// with its own copy of the static pointer and installs the instance it gets
+// through BrowserInterface::startupTrace.
+class StartupTrace
+{
+public:
+    StartupTrace()
+        : m_origin(now())
+    {
+    }
+
+    StartupTrace(const StartupTrace&) = delete;
+    StartupTrace& operator=(const StartupTrace&) = delete;
+
+    static void install(StartupTrace* trace)
+    {
+        s_instance = trace;
+    }
+
+    static void begin(StartupPhase phase)
+    {
+        if (s_instance)
+            s_instance->record(s_instance->m_phases[index(phase)].begin);
+    }
+
+    // Ignored if the phase never began, e.g. the about:blank commit of a
+    // pre-warmed browser before the package url got navigated to.
+    static void end(StartupPhase phase)
+    {
+        if (s_instance && s_instance->m_phases[index(phase)].begin.load(std::memory_order_acquire))
+            s_instance->record(s_instance->m_phases[index(phase)].end);
+    }
+
+    class Scope
+    {
+    public:
+        explicit Scope(StartupPhase phase)
+            : m_phase(phase)
+        {
+            StartupTrace::begin(m_phase);
+        }
+        ~Scope()
+        {
+            StartupTrace::end(m_phase);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const StartupPhase m_phase;
+    };
+
+    // Writes the trace as Chrome trace-event JSON to the given path, or logs
+    // the compact report if the path is empty. Only the first call does
+    // anything, so it can be called from both the signal and the exit path.
+    void dump(const std::string& path)
+    {
+        if (m_dumped.exchange(true))
+            return;
+
+        if (path.empty() || !writeChromeTrace(path))
+            logReport();
+    }
+
+private:
+    struct Phase
+    {
+        std::atomic<uint64_t> begin { 0 };
+        std::atomic<uint64_t> end { 0 };
+    };
+
+    static constexpr size_t index(StartupPhase phase)
+    {
+        return static_cast<size_t>(phase);
+    }
+
+    // ns, never 0 for a recorded point
+    uint64_t now() const
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    void record(std::atomic<uint64_t>& slot)
+    {
+        uint64_t expected = 0;
+        slot.compare_exchange_strong(expected, now(), std::memory_order_acq_rel);
+    }
+
+    // us since the trace was created
+    uint64_t offset(uint64_t timestamp) const
+    {
+        return (timestamp > m_origin) ? ((timestamp - m_origin) / 1000) : 0;
+    }
+
+    void logReport() const
+    {
+        std::array<char, 1024> buffer;
+        size_t length = 0;
+
+        for (size_t i = 0; i < m_phases.size(); ++i)
+        {
+            const uint64_t begin = m_phases[i].begin.load(std::memory_order_acquire);
+            const uint64_t end = m_phases[i].end.load(std::memory_order_acquire);
+            if (!begin || (length >= buffer.size()))
+                continue;
+
+            int written;
+            if (end)
+            {
+                written = snprintf(buffer.data() + length, buffer.size() - length, " %s=%.1fms@%.1f",
+                                   toString(static_cast<StartupPhase>(i)),
+                                   (offset(end) - offset(begin)) / 1000.0, offset(begin) / 1000.0);
+            }
+            else
+            {
+                written = snprintf(buffer.data() + length, buffer.size() - length, " %s=unfinished@%.1f",
+                                   toString(static_cast<StartupPhase>(i)), offset(begin) / 1000.0);
+            }
+            if (written > 0)
+                length += static_cast<size_t>(written);
+        }
+        buffer[std::min(length, buffer.size() - 1)] = '\0';
+
+        g_message("startup trace (ms):%s", length ? buffer.data() : " empty");
+    }
+
+    bool writeChromeTrace(const std::string& path) const
+    {
+        FILE* file = fopen(path.c_str(), "we");
+        if (!file)
+        {
+            g_warning("failed to open startup trace file '%s'", path.c_str());
+            return false;
+        }
+
+        const int pid = getpid();
+        bool first = true;
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        for (size_t i = 0; i < m_phases.size(); ++i)
+        {
+            const uint64_t begin = m_phases[i].begin.load(std::memory_order_acquire);
+            const uint64_t end = m_phases[i].end.load(std::memory_order_acquire);
+            if (!begin)
+                continue;
+
+            // one row per phase, async phases (firebolt, navigation) overlap the others
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":%d,\"tid\":%zu,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 "}",
+                    first ? "" : ",", toString(static_cast<StartupPhase>(i)), pid, i + 1,
+                    offset(begin), end ? (offset(end) - offset(begin)) : 0);
+            first = false;
+        }
+        fputs("]}\n", file);
+
+        const bool result = (fclose(file) == 0);
+        if (result)
+            g_message("startup trace written to '%s'", path.c_str());
+        return result;
+    }
+
+    static inline StartupTrace* s_instance { nullptr };
+
+    const uint64_t m_origin;
+    std::array<Phase, static_cast<size_t>(StartupPhase::COUNT)> m_phases;
+    std::atomic<bool> m_dumped { false };
+};
@@ -18,6 +18,9 @@
  */
 #include <wpe/webkit-web-extension.h>
 
+#include <errno.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/stat.h>
@@ -33,88 +36,313 @@
     sub-directory within the widget called "extensions".  From there WPEWebKit
     will load the extension when the browser instance starts.
 
+    Messages are formatted into a ring of fixed size lines on the thread that
+    logged them and written out in batches by a writer thread, so neither a
+    page flooding the console nor a slow reader on the other end of stdout can
+    make logging dominate the web process.  Beyond a sustained rate messages
+    are dropped, errors excepted, and the drops are reported per level.
+
  */
 
+#define LOG_RING_SLOTS          256     // not above UIO_MAXIOV, one batch is one writev
+#define LOG_LINE_MAX            1024    // longer lines are cut, ending in LOG_TRUNCATED
+#define LOG_TRUNCATED           "[...]"
+#define LOG_RATE_PER_SEC        200     // sustained rate of non-error messages
+#define LOG_RATE_BURST          400
+
+G_STATIC_ASSERT(LOG_RING_SLOTS <= 1024);
+
+enum
+{
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_LOG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+};
+
+typedef struct
+{
+    size_t length;
+    char text[LOG_LINE_MAX];
+} LogLine;
+
+static struct
+{
+    GMutex lock;
+    GCond wake;
+
+    LogLine lines[LOG_RING_SLOTS];
+    unsigned head;                      // next line to fill
+    unsigned queued;                    // lines filled, not claimed by a writer yet
+    unsigned writing;                   // lines claimed, being written
+
+    double tokens;
+    gint64 refilled;
+    unsigned dropped[LOG_LEVEL_COUNT];
+    gint64 reported;
+} s_log;
+
 
 // -----------------------------------------------------------------------------
 /*!
     \internal
 
-    Writes the given console.log message onto stdout.
+    Maps a console level onto the index of its drop counter.
 
  */
-static void logToConsole(WebKitConsoleMessageLevel level, const char *fileName,
-                         unsigned lineNum, const char *message)
+static unsigned levelIndex(WebKitConsoleMessageLevel level)
 {
-    struct timespec ts = { 0, 0 };
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-
-    int n = 0;
-    struct iovec iov[6];
-
-    iov[n].iov_base = (char*)("console.log: ");
-    iov[n].iov_len = 13;
-    n++;
-
-    char tbuf[32];
-    iov[n].iov_base = tbuf;
-    iov[n].iov_len = snprintf(tbuf, sizeof(tbuf), "%.010lu.%.06lu ",
-                              ts.tv_sec, ts.tv_nsec / 1000);
-    iov[n].iov_len = MIN(iov[n].iov_len, sizeof(tbuf));
-    n++;
+    switch (level)
+    {
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_ERROR:
+            return LOG_LEVEL_ERROR;
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_WARNING:
+            return LOG_LEVEL_WARNING;
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_INFO:
+            return LOG_LEVEL_INFO;
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_DEBUG:
+            return LOG_LEVEL_DEBUG;
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_LOG:
+        default:
+            return LOG_LEVEL_LOG;
+    }
+}
 
+static const char *levelPrefix(WebKitConsoleMessageLevel level)
+{
     switch (level)
     {
         case WEBKIT_CONSOLE_MESSAGE_LEVEL_ERROR:
-            iov[n].iov_base = (void*)"ERR: ";
-            iov[n].iov_len = 5;
-            break;
+            return "ERR: ";
         case WEBKIT_CONSOLE_MESSAGE_LEVEL_WARNING:
-            iov[n].iov_base = (void*)"WRN: ";
-            iov[n].iov_len = 5;
-            break;
+            return "WRN: ";
         case WEBKIT_CONSOLE_MESSAGE_LEVEL_LOG:
-            iov[n].iov_base = (void*)"LOG: ";
-            iov[n].iov_len = 5;
-            break;
+            return "LOG: ";
         case WEBKIT_CONSOLE_MESSAGE_LEVEL_INFO:
-            iov[n].iov_base = (void*)"NFO: ";
-            iov[n].iov_len = 5;
-            break;
+            return "NFO: ";
         case WEBKIT_CONSOLE_MESSAGE_LEVEL_DEBUG:
-            iov[n].iov_base = (void*)"DBG: ";
-            iov[n].iov_len = 5;
-            break;
+            return "DBG: ";
         default:
-            iov[n].iov_base = (void*)": ";
-            iov[n].iov_len = 2;
-            break;
+            return ": ";
     }
-    n++;
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Token bucket deciding whether a message of the given level may be queued.
+    Called with the lock held.
+
+ */
+static gboolean takeToken(unsigned index, gint64 now)
+{
+    if (index == LOG_LEVEL_ERROR)
+        return TRUE;
+
+    s_log.tokens = MIN((double) LOG_RATE_BURST,
+                       s_log.tokens + ((now - s_log.refilled) * LOG_RATE_PER_SEC) / (double) G_USEC_PER_SEC);
+    s_log.refilled = now;
+
+    if (s_log.tokens < 1.0)
+        return FALSE;
+
+    s_log.tokens -= 1.0;
+    return TRUE;
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Queues the line last formatted into the head slot and wakes the writer.
+    Called with the lock held.
+
+ */
+static void queueLine(int length)
+{
+    LogLine *line = &s_log.lines[s_log.head];
+
+    // snprintf was given one byte less than the slot, so the newline always fits
+    if (length > LOG_LINE_MAX - 2)
+    {
+        length = LOG_LINE_MAX - 2;
+        memcpy(line->text + length - (sizeof(LOG_TRUNCATED) - 1), LOG_TRUNCATED, sizeof(LOG_TRUNCATED) - 1);
+    }
+    length = MAX(length, 0);
+    line->text[length++] = '\n';
+    line->length = length;
+
+    s_log.head = (s_log.head + 1) % LOG_RING_SLOTS;
+    if (s_log.queued++ == 0)
+        g_cond_signal(&s_log.wake);
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Queues a line with the number of messages dropped since the last one,
+    at most once a second.  Called with the lock held and a free slot.
+
+ */
+static void queueDropReport(const struct timespec *ts, gint64 now)
+{
+    unsigned total = 0;
+    for (unsigned i = 0; i < LOG_LEVEL_COUNT; i++)
+        total += s_log.dropped[i];
 
+    if ((total == 0) || ((now - s_log.reported) < G_USEC_PER_SEC))
+        return;
+
+    queueLine(snprintf(s_log.lines[s_log.head].text, LOG_LINE_MAX - 1,
+                       "console.log: %.010lu.%.06lu WRN: dropped %u messages (ERR:%u WRN:%u LOG:%u NFO:%u DBG:%u)",
+                       (unsigned long) ts->tv_sec, (unsigned long) (ts->tv_nsec / 1000), total,
+                       s_log.dropped[LOG_LEVEL_ERROR], s_log.dropped[LOG_LEVEL_WARNING],
+                       s_log.dropped[LOG_LEVEL_LOG], s_log.dropped[LOG_LEVEL_INFO],
+                       s_log.dropped[LOG_LEVEL_DEBUG]));
+
+    memset(s_log.dropped, 0, sizeof(s_log.dropped));
+    s_log.reported = now;
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Queues the given console.log message for the writer thread, or counts it
+    as dropped if it is over the rate or the ring is full.
+
+ */
+static void logToConsole(WebKitConsoleMessageLevel level, const char *fileName,
+                         unsigned lineNum, const char *message)
+{
+    struct timespec ts = { 0, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const gint64 now = g_get_monotonic_time();
+    const unsigned index = levelIndex(level);
+
+    char where[96] = "";
     if (fileName)
+        snprintf(where, sizeof(where), "< S:%.64s L:%u > ", fileName, lineNum);
+
+    g_mutex_lock(&s_log.lock);
+
+    if (!takeToken(index, now) || ((s_log.queued + s_log.writing) == LOG_RING_SLOTS))
+    {
+        s_log.dropped[index]++;
+        g_mutex_unlock(&s_log.lock);
+        return;
+    }
+
+    queueLine(snprintf(s_log.lines[s_log.head].text, LOG_LINE_MAX - 1,
+                       "console.log: %.010lu.%.06lu %s%s%s",
+                       (unsigned long) ts.tv_sec, (unsigned long) (ts.tv_nsec / 1000),
+                       levelPrefix(level), where, message ?: ""));
+
+    if ((s_log.queued + s_log.writing) < LOG_RING_SLOTS)
+        queueDropReport(&ts, now);
+
+    g_mutex_unlock(&s_log.lock);
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Writes out all of \a iov, picking up after short writes.
+
+ */
+static void writeAll(struct iovec *iov, int count)
+{
+    while (count > 0)
     {
-        char fbuf[156];
-        iov[n].iov_base = (void *) fbuf;
-        iov[n].iov_len = snprintf(fbuf, sizeof(fbuf), "< S:%.*s L:%u > ",
-                                  64, fileName ?: "?",
-                                  lineNum);
-        iov[n].iov_len = MIN(iov[n].iov_len, sizeof(fbuf));
-        n++;
+        ssize_t written = writev(STDOUT_FILENO, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        while ((count > 0) && ((size_t) written >= iov->iov_len))
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
     }
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Writes all lines queued so far in one batch.  Called with the lock held,
+    which is dropped while writing.  The lines are claimed before that, so a
+    concurrent drain takes only lines queued after them, and they stay
+    counted until written so they can't be overwritten meanwhile.
 
-    if (message)
+ */
+static void drainLocked(void)
+{
+    struct iovec iov[LOG_RING_SLOTS];
+
+    const unsigned count = s_log.queued;
+    const unsigned first = (s_log.head + LOG_RING_SLOTS - count) % LOG_RING_SLOTS;
+    for (unsigned i = 0; i < count; i++)
     {
-        iov[n].iov_base = (char *)(message);
-        iov[n].iov_len = strlen(message);
-        n++;
+        LogLine *line = &s_log.lines[(first + i) % LOG_RING_SLOTS];
+        iov[i].iov_base = line->text;
+        iov[i].iov_len = line->length;
     }
 
-    iov[n].iov_base = (void*)"\n";
-    iov[n].iov_len = 1;
-    n++;
+    s_log.queued = 0;
+    s_log.writing += count;
+    g_mutex_unlock(&s_log.lock);
+
+    writeAll(iov, count);
 
-    writev(STDOUT_FILENO, iov, n);
+    g_mutex_lock(&s_log.lock);
+    s_log.writing -= count;
+}
+
+static gpointer logWriterThread(gpointer userData)
+{
+    (void) userData;
+
+    g_mutex_lock(&s_log.lock);
+    for (;;)
+    {
+        while (s_log.queued == 0)
+            g_cond_wait(&s_log.wake, &s_log.lock);
+
+        drainLocked();
+    }
+
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+/*!
+    \internal
+
+    Writes out what is still queued when the web process exits.
+
+ */
+__attribute__((destructor)) static void flushConsoleLog(void)
+{
+    g_mutex_lock(&s_log.lock);
+    if (s_log.queued > 0)
+        drainLocked();
+    g_mutex_unlock(&s_log.lock);
 }
 
 
@@ -171,6 +399,8 @@ G_BEGIN_DECLS
     G_MODULE_EXPORT void webkit_web_extension_initialize_with_user_data(WebKitWebExtension *extension,
                                                                         GVariant *userData)
     {
+        g_thread_unref(g_thread_new("ConsoleLog", logWriterThread, NULL));
+
         g_signal_connect(extension, "page-created",
                          G_CALLBACK(onWebPageCreated),
                          NULL);
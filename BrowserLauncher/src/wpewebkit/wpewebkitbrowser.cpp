@@ -22,21 +22,19 @@
 #include "wpewebkitview.h"
 #include "wpewebkitutils.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <string_view>
-#include <filesystem>
 
 #include <sys/syscall.h>
 #include <glib.h>
 
-namespace fs = std::filesystem;
-
 WpeWebKitBrowser::WpeWebKitBrowser()
     : m_tryCloseTimeout(150)
     , m_browserTerminateTimeout(10000)
-    , m_hangPollIntervalSecs(5)
+    , m_hangCheckIntervalMs(5000)
+    , m_idleHangCheckIntervalMs(30000)
     , m_maxUnresponsiveTimeSecs(60)
-    , m_unresponsivePingNum(0)
 {
 }
 
@@ -59,23 +57,24 @@ bool WpeWebKitBrowser::launch(const std::shared_ptr<const LaunchConfigInterface>
     // remember the main context to dispatch callbacks on
     m_runLoop = std::make_unique<RunLoop>();
 
+    // record into the launcher's trace
+    StartupTrace::install(startupTrace);
+
     // override the max timeout time
     m_maxUnresponsiveTimeSecs = launchConfig->maxUnresponsiveTimeMs() / 1000;
-
-    // remove any old gst cache from previous runs
-    std::error_code ec;
-    if (fs::path gstreamerCache = fs::path { g_get_user_cache_dir() } / "gstreamer-1.0";
-        fs::exists(gstreamerCache, ec))
-    {
-        g_message("clearing gstreamer cache");
-        fs::remove_all(gstreamerCache, ec);
-    }
+    m_hangCheckIntervalMs = std::max(launchConfig->hangCheckIntervalMs(), 100);
+    m_idleHangCheckIntervalMs = std::max(launchConfig->idleHangCheckIntervalMs(), static_cast<int>(m_hangCheckIntervalMs));
 
     // convert the generic launchConfig to WPE specific configuration
+    StartupTrace::begin(StartupPhase::WpeWebKitConfig);
     auto config = std::make_shared<WpeWebKitConfig>(launchConfig);
+    StartupTrace::end(StartupPhase::WpeWebKitConfig);
 
     // set the environment variables from the config
-    config->setEnvironment();
+    {
+        StartupTrace::Scope scope(StartupPhase::SetEnvironment);
+        config->setEnvironment();
+    }
 
     WpeWebKitViewCallbacks viewCallbacks {
         // close
@@ -89,7 +88,17 @@ bool WpeWebKitBrowser::launch(const std::shared_ptr<const LaunchConfigInterface>
         // notifyResponsive
         [this]() {
             g_info("received responsive notification");
-            m_unresponsivePingNum = 0;
+            m_unresponsiveSince = 0;
+            scheduleResponsivenessCheck();
+        },
+        // notifyUnresponsive
+        [this]() {
+            // probe at the active rate until it recovers, whatever the page state
+            if (m_unresponsiveSince == 0)
+            {
+                m_unresponsiveSince = g_get_monotonic_time();
+                scheduleResponsivenessCheck();
+            }
         }
     };
 
@@ -97,6 +106,8 @@ bool WpeWebKitBrowser::launch(const std::shared_ptr<const LaunchConfigInterface>
     m_mainView = std::make_unique<WpeWebKitView>(config, std::move(viewCallbacks));
 
     auto onViewReadyCallback = [this]() {
+        StartupTrace::end(StartupPhase::CreateView);
+
         // notify browser launched on next cycle
         m_runLoop->InvokeTask([this] {
             g_message("signalling that the browser has launched");
@@ -104,23 +115,25 @@ bool WpeWebKitBrowser::launch(const std::shared_ptr<const LaunchConfigInterface>
         }, 0);
     };
 
-    // launch it with the given config
+    // launch it with the given config, the view is ready once it got hidden
+    StartupTrace::begin(StartupPhase::CreateView);
     if (!m_mainView->createView(std::move(onViewReadyCallback)))
     {
         return false;
     }
 
-    GSource *hangTimerSource = g_timeout_source_new_seconds(m_hangPollIntervalSecs);
-    g_source_set_callback(hangTimerSource, G_SOURCE_FUNC(+[](WpeWebKitBrowser* self) {
-        return self->checkBrowserResponsiveness();
-    }), this, nullptr);
-    g_source_attach(hangTimerSource, g_main_context_get_thread_default());
-    g_source_unref(hangTimerSource);
+    scheduleResponsivenessCheck();
     return true;
 }
 
 void WpeWebKitBrowser::dispose()
 {
+    if (m_hangTimerSource)
+    {
+        g_source_destroy(m_hangTimerSource);
+        g_clear_pointer(&m_hangTimerSource, g_source_unref);
+    }
+
     // Destroy web view
     g_message("dispose: destroying browser view");
     m_mainView.reset();
@@ -135,9 +148,29 @@ void WpeWebKitBrowser::navigateTo(const std::string &url)
         return;
     }
     // navigate to the supplied url
+    StartupTrace::begin(StartupPhase::FirstLoadCommitted);
+    StartupTrace::begin(StartupPhase::FirstLoadFinished);
     m_mainView->loadUrl(url);
 }
 
+void WpeWebKitBrowser::preload()
+{
+    // sanity check
+    if (!m_mainView)
+    {
+        g_warning("preload: browser not running - nothing to do");
+        return;
+    }
+
+    m_mainView->preloadBlank([this]() {
+        // notify browser preloaded on next cycle
+        m_runLoop->InvokeTask([this] {
+            g_message("signalling that the browser has preloaded");
+            onPreloaded.emit();
+        }, 0);
+    });
+}
+
 bool WpeWebKitBrowser::setState(PageLifecycleState state)
 {
     // sanity check
@@ -151,6 +184,10 @@ bool WpeWebKitBrowser::setState(PageLifecycleState state)
 
     m_mainView->setState(state);
 
+    // the probe rate follows the page state
+    m_pageState = state;
+    scheduleResponsivenessCheck();
+
     if (state == PageLifecycleState::TERMINATED)
     {
         close();
@@ -250,29 +287,66 @@ void WpeWebKitBrowser::onBrowserUnresponsive(
     }
 }
 
-int WpeWebKitBrowser::checkBrowserResponsiveness()
+/*!
+    \internal
+
+    (Re)arms the web process watchdog. The process is probed at the active
+    rate while the page is shown or while WebKit reported it unresponsive, and
+    only sparsely while the page is hidden or frozen and not expected to do
+    much. Stalls are timed from the moment they were first noticed.
+ */
+void WpeWebKitBrowser::scheduleResponsivenessCheck()
 {
-    if (!m_mainView)
+    if (m_hangTimerSource)
+    {
+        g_source_destroy(m_hangTimerSource);
+        g_clear_pointer(&m_hangTimerSource, g_source_unref);
+    }
+
+    if (!m_mainView || m_pageState == PageLifecycleState::TERMINATED)
+        return;
+
+    const bool idle = (m_pageState == PageLifecycleState::HIDDEN || m_pageState == PageLifecycleState::FROZEN);
+    const guint intervalMs = (idle && m_unresponsiveSince == 0) ? m_idleHangCheckIntervalMs : m_hangCheckIntervalMs;
+
+    m_hangCheckDueAt = g_get_monotonic_time() + static_cast<gint64>(intervalMs) * 1000;
+    m_hangTimerSource = g_timeout_source_new(intervalMs);
+    g_source_set_callback(m_hangTimerSource, G_SOURCE_FUNC(+[](WpeWebKitBrowser* self) {
+        self->checkBrowserResponsiveness();
         return G_SOURCE_REMOVE;
+    }), this, nullptr);
+    g_source_attach(m_hangTimerSource, g_main_context_get_thread_default());
+}
+
+void WpeWebKitBrowser::checkBrowserResponsiveness()
+{
+    if (!m_mainView)
+        return;
+
+    // the probe timer doubles as the main loop heartbeat, lateness is time the loop couldn't run
+    const gint64 lateMs = (g_get_monotonic_time() - m_hangCheckDueAt) / 1000;
+    if (lateMs > 1000)
+        g_warning("main loop stalled, responsiveness check %" G_GINT64_FORMAT " ms late", lateMs);
 
     const bool isResponsive = m_mainView->checkResponsive();
     g_info("check browser responsiveness : %s", isResponsive ? "true" : "false");
 
     if (isResponsive)
     {
-        m_unresponsivePingNum = 0;
+        m_unresponsiveSince = 0;
     }
     else
     {
-        ++m_unresponsivePingNum;
+        const gint64 now = g_get_monotonic_time();
+        if (m_unresponsiveSince == 0)
+            m_unresponsiveSince = now - static_cast<gint64>(m_hangCheckIntervalMs) * 1000;
 
-        const uint32_t secsUnresponsive = m_unresponsivePingNum * m_hangPollIntervalSecs;
+        const int64_t secsUnresponsive = (now - m_unresponsiveSince) / G_USEC_PER_SEC;
         const int webProcessPid = m_mainView->getWebProcessIdentifier();
         onBrowserUnresponsive(secsUnresponsive, webProcessPid);
     }
 
-    return G_SOURCE_CONTINUE;
-
+    scheduleResponsivenessCheck();
 }
 
 // Factory function for instantiating WpeWebKitBrowser.
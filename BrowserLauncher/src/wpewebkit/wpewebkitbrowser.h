@@ -26,6 +26,7 @@
 #include <optional>
 
 typedef struct _GMainContext GMainContext;
+typedef struct _GSource GSource;
 class WpeWebKitView;
 class BridgeObjectImpl;
 
@@ -38,6 +39,7 @@ public:
     bool launch(const std::shared_ptr<const LaunchConfigInterface> &launchConfig) override;
     void dispose() override;
     void navigateTo(const std::string &url) override;
+    void preload() override;
     bool setState(PageLifecycleState state) override;
     void setScreenSupportsHDR(bool enable) override;
 
@@ -47,16 +49,21 @@ private:
     void onBrowserCrashed();
     void onBrowserUnresponsive(int64_t secsSinceLastResponsive, int webProcessPid);
     void invokeOnMainThreadLoop(std::function<void()> call, std::optional<uint32_t> delay = {});
-    int  checkBrowserResponsiveness();
+    void checkBrowserResponsiveness();
+    void scheduleResponsivenessCheck();
 
 private:
     GMainContext *m_mainThreadContext { nullptr };
 
     const int m_tryCloseTimeout;
     const int m_browserTerminateTimeout;
-    const unsigned m_hangPollIntervalSecs;
+    unsigned m_hangCheckIntervalMs;
+    unsigned m_idleHangCheckIntervalMs;
     int m_maxUnresponsiveTimeSecs;
-    uint32_t m_unresponsivePingNum;
+    int64_t m_unresponsiveSince { 0 };
+    int64_t m_hangCheckDueAt { 0 };
+    PageLifecycleState m_pageState { PageLifecycleState::INITIALIZING };
+    GSource *m_hangTimerSource { nullptr };
     bool m_unloading { false };
 
     std::unique_ptr<WpeWebKitView> m_mainView;
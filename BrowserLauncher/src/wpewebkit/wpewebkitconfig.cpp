@@ -18,13 +18,20 @@
  */
 #include "wpewebkitconfig.h"
 #include "wpewebkitutils.h"
+#include "../startuptrace.h"
 
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/sysinfo.h>
 
+#include <cerrno>
+#include <cstdio>
+
 #include <array>
 #include <regex>
 #include <bit>
+#include <map>
 #include <set>
 #include <fstream>
 #include <filesystem>
@@ -75,6 +82,130 @@ void prependLdLibraryPath(const std::string& value, const bool replace = true)
     setEnvVar("LD_LIBRARY_PATH", ldLibPath, replace);
 }
 
+/*!
+    \internal
+
+    Returns the first \a length hex characters of the SHA1 of \a data, used to
+    key the caches that are kept across launches.
+ */
+std::string shortChecksum(const std::string& data, size_t length = 16)
+{
+    gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, data.c_str(), data.length());
+    std::string result(checksum ? checksum : "");
+    g_free(checksum);
+    return result.substr(0, length);
+}
+
+/*!
+    \internal
+
+    Checks that \a dir is a real directory (not a symlink) owned by the
+    current user and accessible by nobody else, so its contents can be
+    trusted.
+ */
+bool isPrivateDirectory(const std::string& dir)
+{
+    struct stat st;
+    if (lstat(dir.c_str(), &st) != 0)
+        return false;
+
+    return S_ISDIR(st.st_mode) && (st.st_uid == getuid()) && ((st.st_mode & 07777) == 0700);
+}
+
+/*!
+    \internal
+
+    Returns the per-user directory the keyed extension dirs are kept in,
+    creating it if needed, or an empty string if there is no usable one.
+ */
+std::string extensionCacheDirectory()
+{
+    const char *runtimeDir = g_getenv("XDG_RUNTIME_DIR");
+    gchar *path = g_build_filename((runtimeDir && *runtimeDir) ? runtimeDir : g_get_user_cache_dir(),
+                                   "wpewebkit-extensions", nullptr);
+    const std::string directory = path;
+    g_free(path);
+
+    if (g_mkdir_with_parents(directory.c_str(), 0700) != 0 || !isPrivateDirectory(directory))
+    {
+        g_warning("extension cache dir '%s' is not private to this user, not using it", directory.c_str());
+        return {};
+    }
+    return directory;
+}
+
+/*!
+    \internal
+
+    Checks that \a dir holds exactly the symlinks in \a links (file name to
+    target).
+ */
+bool hasExactSymlinks(const std::string& dir, const std::map<std::string, std::string>& links)
+{
+    std::error_code ec;
+    size_t found = 0;
+
+    for (const auto& entry : fs::directory_iterator(dir, ec))
+    {
+        const auto it = links.find(entry.path().filename().string());
+        if (it == links.end() || !entry.is_symlink(ec))
+            return false;
+
+        if (fs::read_symlink(entry.path(), ec) != fs::path(it->second) || ec)
+            return false;
+
+        ++found;
+    }
+
+    return !ec && found == links.size();
+}
+
+/*!
+    \internal
+
+    Fingerprint of the gstreamer plugins that will be picked up: the name, size
+    and modification time of every plugin in the plugin paths. Changes whenever
+    a plugin is added, removed or replaced.
+ */
+std::string gstPluginFingerprint()
+{
+    std::string paths;
+    if (const char* systemPath = g_getenv("GST_PLUGIN_SYSTEM_PATH"); systemPath && systemPath[0])
+        paths = systemPath;
+    else
+        paths = "/usr/lib/gstreamer-1.0:/usr/lib64/gstreamer-1.0";
+    if (const char* extraPath = g_getenv("GST_PLUGIN_PATH"); extraPath && extraPath[0])
+        paths += std::string(":") + extraPath;
+
+    std::string fingerprint = paths + '\n';
+    std::set<std::string> plugins;
+
+    std::istringstream pathStream(paths);
+    std::string dir;
+    while (std::getline(pathStream, dir, ':'))
+    {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec))
+        {
+            if (entry.path().extension() != ".so")
+                continue;
+
+            // follows symlinks, so replaced targets are noticed too
+            const auto size = entry.file_size(ec);
+            const auto mtime = entry.last_write_time(ec).time_since_epoch().count();
+            if (ec)
+                continue;
+
+            plugins.insert(entry.path().string() + ' ' + std::to_string(size) + ' ' + std::to_string(mtime));
+        }
+    }
+
+    for (const auto& plugin : plugins)
+        fingerprint += plugin + '\n';
+
+    return shortChecksum(fingerprint);
+}
+
 std::string findLibrary(const std::string& runtimeDir, const std::string& fileName)
 {
     std::error_code ignore;
@@ -107,7 +238,9 @@ std::string findLibrary(const std::string& runtimeDir, const std::string& fileNa
 WpeWebKitConfig::WpeWebKitConfig(const std::shared_ptr<const LaunchConfigInterface> &launchConfig)
     : m_launchConfig(launchConfig)
 {
+    StartupTrace::begin(StartupPhase::InitExtensionDir);
     initExtensionDir();
+    StartupTrace::end(StartupPhase::InitExtensionDir);
 
     // memory limits for WPE are based on cgroup limits so read that first
     unsigned long totalLimitMb = readLimits("/sys/fs/cgroup/memory/memory.limit_in_bytes", 200);
@@ -135,35 +268,29 @@ WpeWebKitConfig::WpeWebKitConfig(const std::shared_ptr<const LaunchConfigInterfa
 
 WpeWebKitConfig::~WpeWebKitConfig()
 {
-    if (std::error_code ec; fs::exists(m_extTmpDirectory, ec))
+    // the keyed extension dir is left for the next launch
+    if (std::error_code ec; m_extDirectoryIsTemporary && fs::exists(m_extDirectory, ec))
     {
         g_message("clearing tmp dir");
-        fs::remove_all(m_extTmpDirectory, ec);
+        fs::remove_all(m_extDirectory, ec);
     }
 }
 
 /*!
     \internal
 
-    Creates the temporary directory for the extensions and then adds symlinks
-    to point back to the real extensions based on what extensions should be
-    loaded.
+    Sets up the directory with symlinks to the extensions that should be loaded.
+
+    The directory is named after a checksum of the extension set and is kept
+    across launches in a per-user location, so a launch with the same set only
+    has to validate the existing symlinks. A new set is populated in a private
+    temporary directory which is then moved into place, unless the keyed one
+    already exists.
  */
 bool WpeWebKitConfig::initExtensionDir()
 {
-    gchar *tmpDir = g_mkdtemp(g_build_filename(g_get_tmp_dir(), "webkit.view.extensions.XXXXXX", nullptr));
-    if (tmpDir != nullptr)
-    {
-        m_extTmpDirectory = tmpDir;
-        g_clear_pointer(&tmpDir, g_free);
-    }
-
-    // populate the temporary extension dir with symlinks
-    if (m_extTmpDirectory.empty())
-    {
-        g_critical("failed to create temporary directory for the extensions");
-        return false;
-    }
+    // file name -> target of every extension to load
+    std::map<std::string, std::string> links;
 
     // default extensions, always loaded
     std::set<std::string> extensions {
@@ -176,12 +303,10 @@ bool WpeWebKitConfig::initExtensionDir()
 
     std::string extDirectory = m_launchConfig->runtimeDir() + "/wpewebkit/extensions";
 
-    // symlink the extensions
     for (const auto &extFileName : extensions)
     {
         std::error_code ec;
         const std::string oldPath = extDirectory + "/" + extFileName;
-        const std::string newPath = m_extTmpDirectory + "/" + extFileName;
         if (!fs::exists(oldPath, ec))
         {
             g_warning("failed to find web extension '%s' at '%s'",
@@ -189,17 +314,7 @@ bool WpeWebKitConfig::initExtensionDir()
             continue;
         }
 
-        fs::create_symlink(oldPath, newPath, ec);
-        if (ec)
-        {
-            g_critical("failed to create symlink '%s' -> '%s', %s",
-                       oldPath.c_str(), newPath.c_str(), ec.message().c_str());
-        }
-        else
-        {
-            g_message("added extension symlink '%s' -> '%s'",
-                      oldPath.c_str(), newPath.c_str());
-        }
+        links[extFileName] = oldPath;
     }
 
     // add any extra extensions from the app package
@@ -207,7 +322,6 @@ bool WpeWebKitConfig::initExtensionDir()
     for (const auto &appExtFilePath : extraAppExts)
     {
         std::error_code ec;
-        const std::string newPath = m_extTmpDirectory + "/" + fs::path(appExtFilePath).filename().string();
         if (!fs::exists(appExtFilePath, ec))
         {
             g_warning("failed to find web extension '%s'",
@@ -215,19 +329,87 @@ bool WpeWebKitConfig::initExtensionDir()
             continue;
         }
 
-        fs::create_symlink(appExtFilePath, newPath, ec);
+        links[fs::path(appExtFilePath).filename().string()] = appExtFilePath;
+    }
+
+    std::string key;
+    for (const auto &[name, target] : links)
+        key += name + '=' + target + '\n';
+
+    // the keyed dir is only trusted if nobody but us can have put it there
+    const std::string cacheDirectory = extensionCacheDirectory();
+    std::string cachedDirectory;
+    if (!cacheDirectory.empty())
+    {
+        cachedDirectory = cacheDirectory + "/" + shortChecksum(key);
+        if (isPrivateDirectory(cachedDirectory) && hasExactSymlinks(cachedDirectory, links))
+        {
+            g_message("reusing extension dir '%s'", cachedDirectory.c_str());
+            m_extDirectory = cachedDirectory;
+            return true;
+        }
+    }
+
+    // populate a private dir, next to the keyed one so it can be renamed into place
+    const std::string tmpParent = cacheDirectory.empty() ? std::string(g_get_tmp_dir()) : cacheDirectory;
+    gchar *tmpDir = g_mkdtemp(g_build_filename(tmpParent.c_str(), "webkit.view.extensions.XXXXXX", nullptr));
+    if (tmpDir == nullptr)
+    {
+        g_critical("failed to create temporary directory for the extensions");
+        return false;
+    }
+    const std::string newDirectory = tmpDir;
+    g_free(tmpDir);
+
+    // populate the temporary extension dir with symlinks
+    for (const auto &[name, target] : links)
+    {
+        std::error_code ec;
+        const std::string newPath = newDirectory + "/" + name;
+
+        fs::create_symlink(target, newPath, ec);
         if (ec)
         {
             g_critical("failed to create symlink '%s' -> '%s', %s",
-                       appExtFilePath.c_str(), newPath.c_str(), ec.message().c_str());
+                       target.c_str(), newPath.c_str(), ec.message().c_str());
         }
         else
         {
             g_message("added extension symlink '%s' -> '%s'",
-                      appExtFilePath.c_str(), newPath.c_str());
+                      target.c_str(), newPath.c_str());
         }
     }
 
+    m_extDirectory = newDirectory;
+    m_extDirectoryIsTemporary = true;
+
+    // Move it in place if the keyed dir doesn't exist. One that exists is
+    // never replaced, another launcher may be running from it; if it is
+    // stale or not ours this run keeps the private copy.
+    if (cachedDirectory.empty())
+        return true;
+
+    const int result = renameat2(AT_FDCWD, newDirectory.c_str(), AT_FDCWD, cachedDirectory.c_str(), RENAME_NOREPLACE);
+    const int error = (result == 0) ? 0 : errno;
+    if (result == 0)
+    {
+        m_extDirectory = cachedDirectory;
+        m_extDirectoryIsTemporary = false;
+    }
+    else if (error == EEXIST && isPrivateDirectory(cachedDirectory) && hasExactSymlinks(cachedDirectory, links))
+    {
+        // another launch raced us to it
+        std::error_code ec;
+        fs::remove_all(newDirectory, ec);
+        m_extDirectory = cachedDirectory;
+        m_extDirectoryIsTemporary = false;
+    }
+    else
+    {
+        g_warning("not moving extension dir to '%s', %s, using '%s'",
+                  cachedDirectory.c_str(), g_strerror(error), newDirectory.c_str());
+    }
+
     return true;
 }
 
@@ -342,6 +524,38 @@ void WpeWebKitConfig::setGStreamerEnvironment() const
     setEnvVar("WEBKIT_GST_HOLE_PUNCH_QUIRK", "westeros", false);
 }
 
+/*!
+    \internal
+
+    Keeps the gstreamer registry across launches instead of rescanning all the
+    plugins each time. The registry file is keyed by a fingerprint of the
+    installed plugins so it is only rebuilt when they change, and only the
+    current one is kept to limit flash usage.
+ */
+void WpeWebKitConfig::setGStreamerRegistry() const
+{
+    const fs::path cacheDir = fs::path { g_get_user_cache_dir() } / "gstreamer-1.0";
+    const std::string registryName = "registry." + gstPluginFingerprint() + ".bin";
+
+    std::error_code ec;
+    fs::create_directories(cacheDir, ec);
+
+    // remove registries of other plugin sets, including the default per-arch one
+    for (const auto& entry : fs::directory_iterator(cacheDir, ec))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name != registryName && name.starts_with("registry.") && name.ends_with(".bin"))
+        {
+            g_message("removing stale gstreamer registry '%s'", name.c_str());
+            std::error_code ignore;
+            fs::remove(entry.path(), ignore);
+        }
+    }
+
+    setEnvVar("GST_REGISTRY", (cacheDir / registryName).string(), false);
+    g_message("GST_REGISTRY = %s", g_getenv("GST_REGISTRY"));
+}
+
 /*!
     \internal
 
@@ -522,9 +736,6 @@ void WpeWebKitConfig::setEnvironment() const
         // limit localStorage SQLite wal journal file, because unless it's growing
         // indefinitely. Set value means pages, so it is limited to ~40kB
         setEnvVar("WPE_WAL_AUTOCHECKPOINT", "10", false);
-
-        // disable persistent gstreamer cache - instead put it in /tmp
-        setEnvVar("GST_REGISTRY", "/tmp/gstreamer-registry.bin", false);
     }
 
     // memory limits
@@ -581,6 +792,9 @@ void WpeWebKitConfig::setEnvironment() const
         setGStreamerEnvironment();
     }
 
+    // the plugin paths are final now, point gstreamer at the registry for them
+    setGStreamerRegistry();
+
     // for Mali platforms need to set WPE_POLL_GPU_IN_FOOTPRINT=1 for removing
     // the memory footprint from the RSS otherwise it skews the memory pressure
     // logic
@@ -923,12 +1137,13 @@ WebKitCookieAcceptPolicy WpeWebKitConfig::cookieAcceptPolicy() const
 
     Because we now have a lot of extensions and most aren't needed from one app
     to another, we now create a directory in /tmp and symlink to the extensions
-    we needed for the app.
+    we needed for the app. The directory is shared by launches that load the
+    same set of extensions.
 
  */
 std::string WpeWebKitConfig::extensionsDirectory() const
 {
-    return m_extTmpDirectory;
+    return m_extDirectory;
 }
 
 /*!
@@ -136,9 +136,12 @@ private:
 
     bool setRialtoEnvironment() const;
 
+    void setGStreamerRegistry() const;
+
 private:
     std::shared_ptr<const LaunchConfigInterface> m_launchConfig;
 
     MemoryLimits m_memLimits { };
-    std::string m_extTmpDirectory;
+    std::string m_extDirectory;
+    bool m_extDirectoryIsTemporary { false };
 };
@@ -27,11 +27,15 @@
 #include "testing/testrunner.h"
 #endif
 
+#include <algorithm>
 #include <deque>
 #include <cmath>
 #include <cinttypes>
 #include <optional>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace {
 
 // Destroys timer source conducting all necessary checks.
@@ -129,6 +133,37 @@ PageLifecycleState nextState(PageLifecycleState current, PageLifecycleState targ
     return target;
 }
 
+// Resident set size of the given process in bytes, read from /proc/<pid>/statm.
+std::optional<uint64_t> readResidentBytes(pid_t pid)
+{
+    std::optional<uint64_t> result;
+    if (pid < 1)
+        return result;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/statm", static_cast<int>(pid));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return result;
+
+    char buffer[128];
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+
+    unsigned long long size = 0, resident = 0;
+    if (length > 0)
+    {
+        buffer[length] = '\0';
+        if (sscanf(buffer, "%llu %llu", &size, &resident) == 2)
+        {
+            static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            result = resident * pageSize;
+        }
+    }
+    return result;
+}
+
 std::optional<guint> getMemoryPressureMonitorModeByName(const char name[], std::string& nick)
 {
     std::optional<guint> result;
@@ -168,10 +203,13 @@ protected:
     const unsigned m_maxMemorySavingIterations;
     unsigned m_memorySavingTimerIteration { 0 };
     GSource *m_memorySavingTimerSource{nullptr};
+    bool m_memorySavingCritical { false };
+    std::optional<uint64_t> m_memorySavingLastRSS;
 
     void enableMemorySaving();
     void disableMemorySaving();
     void onMemorySavingTimerTimeout();
+    bool continueMemorySaving();
 
 public:
     WpePageLifecycleDelegate(WebKitWebView* view, unsigned maxMemorySavingIterations)
@@ -285,6 +323,9 @@ void WpePageLifecycleDelegate::enableMemorySaving()
         g_message("enabling memory saving mode");
 
         m_memorySavingTimerIteration = 0;
+        // a single event leaves no room to escalate, keep it critical as it always was
+        m_memorySavingCritical = (m_maxMemorySavingIterations == 1);
+        m_memorySavingLastRSS.reset();
         m_memorySavingTimerSource = g_timeout_source_new(0);
         g_source_set_callback(m_memorySavingTimerSource,
                               G_SOURCE_FUNC(+[](WpePageLifecycleDelegate* self) {
@@ -318,6 +359,51 @@ void WpePageLifecycleDelegate::disableMemorySaving()
     }
 }
 
+/*!
+    \internal
+
+    Decides from the web process RSS whether the previous memory pressure event
+    was worth it. Saving starts with a non critical event, escalates to critical
+    ones once a level stops reclaiming and ends once critical ones do not help
+    any more either. With a budget of one event that event is critical. Without RSS readings it keeps sending critical events up to
+    the maximum number of iterations.
+ */
+bool WpePageLifecycleDelegate::continueMemorySaving()
+{
+    // reclaim below max(1MiB, 1% of RSS) is considered flat
+    constexpr uint64_t minReclaimBytes = 1024 * 1024;
+    constexpr uint64_t minReclaimDivisor = 100;
+
+    const pid_t webProcessPid = webkit_web_view_get_web_process_identifier(m_view);
+    const std::optional<uint64_t> rss = readResidentBytes(webProcessPid);
+    const std::optional<uint64_t> previous = m_memorySavingLastRSS;
+    m_memorySavingLastRSS = rss;
+
+    if (!rss || !previous)
+    {
+        if (!rss)
+            m_memorySavingCritical = true;
+        return true;
+    }
+
+    const uint64_t reclaimed = (*previous > *rss) ? (*previous - *rss) : 0;
+    const uint64_t threshold = std::max(minReclaimBytes, *previous / minReclaimDivisor);
+
+    g_info("memory pressure event # %u reclaimed %" PRIu64 " KiB (rss %" PRIu64 " KiB)",
+           m_memorySavingTimerIteration, reclaimed / 1024, *rss / 1024);
+
+    if (reclaimed >= threshold)
+        return true;
+
+    if (!m_memorySavingCritical)
+    {
+        m_memorySavingCritical = true;
+        return true;
+    }
+
+    return false;
+}
+
 /*!
     \internal
 
@@ -336,12 +422,17 @@ void WpePageLifecycleDelegate::onMemorySavingTimerTimeout()
         m_memorySavingTimerIteration = 0;
         g_message("stopping memory saving mode");
     }
+    else if (!continueMemorySaving())
+    {
+        m_memorySavingTimerIteration = 0;
+        g_message("stopping memory saving mode, no more memory reclaimed");
+    }
     else
     {
-        g_info("sending critical memory pressure event # %u to view", m_memorySavingTimerIteration);
+        g_info("sending %s memory pressure event # %u to view",
+               m_memorySavingCritical ? "critical" : "non-critical", m_memorySavingTimerIteration);
 
-        constexpr auto critical = true;
-        webkit_web_view_send_memory_pressure_event(m_view, critical);
+        webkit_web_view_send_memory_pressure_event(m_view, m_memorySavingCritical);
 
         m_memorySavingTimerIteration++;
         if (m_memorySavingTimerIteration < m_maxMemorySavingIterations)
@@ -471,13 +562,15 @@ class WpePageLifecycleV2 : public WpePageLifecycleDelegate
         using CompletionHandler = std::function<void(gboolean)>;
         virtual ~StateChangeTask() = default;
         virtual const char* name() const = 0;
+        virtual const char* inverse() const { return nullptr; }
         virtual gboolean run(WebKitWebView* view, CompletionHandler&& handler) = 0;
     };
 
-#define DEFINE_PAGESTATE_CHANGE(_Name, _name)                           \
+#define DEFINE_PAGESTATE_CHANGE(_Name, _name, _inverse)                 \
     struct Async##_Name : public StateChangeTask                        \
     {                                                                   \
         const char* name() const override { return #_name; }            \
+        const char* inverse() const override { return #_inverse; }      \
                                                                         \
         gboolean run(WebKitWebView* view, CompletionHandler&& handler) override { \
             g_message("plc_v2: attempting to " #_name " the page");     \
@@ -501,12 +594,12 @@ class WpePageLifecycleV2 : public WpePageLifecycleDelegate
         }                                                               \
     }                                                                   \
 
-    DEFINE_PAGESTATE_CHANGE(Show, show);
-    DEFINE_PAGESTATE_CHANGE(Hide, hide);
-    DEFINE_PAGESTATE_CHANGE(Blur, blur);
-    DEFINE_PAGESTATE_CHANGE(Focus, focus);
-    DEFINE_PAGESTATE_CHANGE(Freeze, freeze);
-    DEFINE_PAGESTATE_CHANGE(Resume, resume);
+    DEFINE_PAGESTATE_CHANGE(Show, show, hide);
+    DEFINE_PAGESTATE_CHANGE(Hide, hide, show);
+    DEFINE_PAGESTATE_CHANGE(Blur, blur, focus);
+    DEFINE_PAGESTATE_CHANGE(Focus, focus, blur);
+    DEFINE_PAGESTATE_CHANGE(Freeze, freeze, resume);
+    DEFINE_PAGESTATE_CHANGE(Resume, resume, freeze);
 #undef DEFINE_PAGESTATE_CHANGE
 
     struct TryClose : public StateChangeTask
@@ -579,8 +672,46 @@ class WpePageLifecycleV2 : public WpePageLifecycleDelegate
         }
     }
 
+    /*!
+        Coalesces the new state change with the ones still pending.
+
+        The page states form a chain (frozen - hidden - visible - focused) so the
+        pending changes are a walk along it, cancelling the last pending change
+        against its inverse (and dropping repeats) keeps the queue at the minimal
+        path from the committed state to the latest target. The change in flight
+        is never touched and try_close acts as a barrier.
+     */
+    bool coalesceAsyncChange(const StateChangeTask& change)
+    {
+        const size_t inFlight = m_asyncStateChangeInProgress ? 1 : 0;
+        if (m_stateChangeQueue.size() <= inFlight)
+            return false;
+
+        const StateChangeTask& last = *m_stateChangeQueue.back();
+        if (strcmp(last.name(), change.name()) == 0 && last.inverse())
+        {
+            g_message("plc_v2: dropping repeated '%s' state change", change.name());
+            return true;
+        }
+
+        if (last.inverse() && strcmp(last.inverse(), change.name()) == 0)
+        {
+            g_message("plc_v2: '%s' cancels pending '%s' state change", change.name(), last.name());
+            m_stateChangeQueue.pop_back();
+            return true;
+        }
+
+        return false;
+    }
+
     void enqueueAsyncChange(std::unique_ptr<StateChangeTask> &&change)
     {
+        if (coalesceAsyncChange(*change))
+        {
+            scheduleNextItemProcessing();
+            return;
+        }
+
         g_message("plc_v2: enqueuing async '%s' state change", change->name());
         m_stateChangeQueue.emplace_back(std::move(change));
         scheduleNextItemProcessing();
@@ -1056,6 +1187,22 @@ bool WpeWebKitView::loadUrl(const std::string &url)
     return true;
 }
 
+/*!
+    Loads about:blank to get the web process spawned and the extensions loaded
+    ahead of the first real navigation. The callback is invoked once the load
+    finished (or failed).
+ */
+bool WpeWebKitView::preloadBlank(std::function<void()> && preloadedCallback)
+{
+    if (!loadUrl("about:blank"))
+    {
+        return false;
+    }
+
+    m_preloadedCallback = std::move(preloadedCallback);
+    return true;
+}
+
 /*!
     Attempts to change the lifecycle state of the web page, transitioning through intermittent states if needed.
       https://developer.chrome.com/docs/web-platform/page-lifecycle-api
@@ -1312,9 +1459,17 @@ void WpeWebKitView::loadChangedCallback(WebKitWebView *webView,
             break;
         case WEBKIT_LOAD_COMMITTED:
             g_message("wpe load committed to '%s'", url);
+            StartupTrace::end(StartupPhase::FirstLoadCommitted);
             break;
         case WEBKIT_LOAD_FINISHED:
             g_message("wpe load finished '%s'", url);
+            StartupTrace::end(StartupPhase::FirstLoadFinished);
+            if (self->m_preloadedCallback)
+            {
+                auto preloadedCallback = std::move(self->m_preloadedCallback);
+                self->m_preloadedCallback = nullptr;
+                preloadedCallback();
+            }
             break;
     }
 }
@@ -1492,6 +1647,8 @@ void WpeWebKitView::isWebProcessResponsiveCallback(WebKitWebView *webView,
     else
     {
         g_warning("WebProcess is currently unresponsive");
+
+        self->m_callbacks.notifyUnresponsive();
     }
 }
 
@@ -42,6 +42,8 @@ struct WpeWebKitViewCallbacks
     std::function<void()> processTerminated;
     // Called when Web Process has become responsive again.
     std::function<void()> notifyResponsive;
+    // Called when WebKit noticed the Web Process stopped responding.
+    std::function<void()> notifyUnresponsive;
 };
 
 class WpePageLifecycleDelegate;
@@ -55,6 +57,7 @@ public:
 
     bool createView(std::function<void()> && viewReadyCallback);
     bool loadUrl(const std::string &url);
+    bool preloadBlank(std::function<void()> && preloadedCallback);
     bool setState(PageLifecycleState state);
     bool tryClose();
     bool checkResponsive();
@@ -128,6 +131,8 @@ private:
 
     int m_unresponsiveReplies;
 
+    std::function<void()> m_preloadedCallback;
+
     std::unique_ptr<WpePageLifecycleDelegate> m_pageLifecycle;
 
 #if defined(ENABLE_TESTING)
@@ -27,6 +27,9 @@
 #endif
 
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace {
 
@@ -150,10 +153,13 @@ void BrowserLauncherTest::launchBrowser(const std::string& url, std::vector<std:
     EXPECT_EQ(_launcher, nullptr);
     EXPECT_EQ(_runtime_process, nullptr);
 
+    const bool prewarm = std::find(args.begin(), args.end(), "--prewarm") != args.end();
+
     GError *error = nullptr;
     _launcher = g_subprocess_launcher_new(
         static_cast<GSubprocessFlags>(G_SUBPROCESS_FLAGS_INHERIT_FDS |
-                                      G_SUBPROCESS_FLAGS_SEARCH_PATH_FROM_ENVP));
+                                      G_SUBPROCESS_FLAGS_SEARCH_PATH_FROM_ENVP |
+                                      (prewarm ? G_SUBPROCESS_FLAGS_STDIN_PIPE : G_SUBPROCESS_FLAGS_NONE)));
 
     if (_server_port > 0)
     {
@@ -175,8 +181,11 @@ void BrowserLauncherTest::launchBrowser(const std::string& url, std::vector<std:
 #endif
 
     char **new_argv;
-    args.emplace_back("--url");
-    args.emplace_back(url);
+    if (!url.empty())
+    {
+        args.emplace_back("--url");
+        args.emplace_back(url);
+    }
     new_argv = g_newa(char *, args.size() + 2);
     if (!new_argv)
     {
@@ -199,6 +208,88 @@ void BrowserLauncherTest::launchBrowser(const std::string& url, std::vector<std:
     EXPECT_NE(_runtime_process, nullptr);
 }
 
+void BrowserLauncherTest::prewarmBrowser(std::vector<std::string> args)
+{
+    args.emplace_back("--prewarm");
+    launchBrowser(std::string(), std::move(args));
+}
+
+void BrowserLauncherTest::adoptPrewarmedBrowser(const std::string& url)
+{
+    EXPECT_NE(_runtime_process, nullptr);
+    if (!_runtime_process)
+        return;
+
+    GOutputStream *stdin_pipe = g_subprocess_get_stdin_pipe(_runtime_process);
+    EXPECT_NE(stdin_pipe, nullptr);
+    if (!stdin_pipe)
+        return;
+
+    GError *error = nullptr;
+    const std::string request = url + "\n";
+    g_output_stream_write_all(stdin_pipe, request.data(), request.size(), nullptr, nullptr, &error);
+    EXPECT_EQ(error, nullptr);
+    g_clear_error(&error);
+}
+
+// Sum of the peak resident set sizes (VmHWM) of the launcher and every process it spawned
+// (web, network processes), in kB. Only meaningful while the browser is running.
+long BrowserLauncherTest::browserPeakRssKb() const
+{
+    if (!_runtime_process)
+        return 0;
+
+    const char *identifier = g_subprocess_get_identifier(_runtime_process);
+    if (!identifier)
+        return 0;
+
+    long total = 0;
+    std::vector<std::string> pids { identifier };
+    while (!pids.empty())
+    {
+        const std::string pid = std::move(pids.back());
+        pids.pop_back();
+
+        gchar_ptr status_path { g_strdup_printf("/proc/%s/status", pid.c_str()) };
+        if (FILE *status = fopen(status_path.get(), "re"))
+        {
+            char line[256];
+            while (fgets(line, sizeof(line), status))
+            {
+                if (strncmp(line, "VmHWM:", 6) == 0)
+                {
+                    total += strtol(line + 6, nullptr, 10);
+                    break;
+                }
+            }
+            fclose(status);
+        }
+
+        // children are listed per thread, the helper processes are not necessarily spawned by the main one
+        gchar_ptr task_path { g_strdup_printf("/proc/%s/task", pid.c_str()) };
+        GDir *tasks = g_dir_open(task_path.get(), 0, nullptr);
+        if (!tasks)
+            continue;
+        while (const char *task = g_dir_read_name(tasks))
+        {
+            gchar *children = nullptr;
+            gchar_ptr children_path { g_build_filename(task_path.get(), task, "children", nullptr) };
+            if (!g_file_get_contents(children_path.get(), &children, nullptr, nullptr))
+                continue;
+            gchar **child_pids = g_strsplit(g_strstrip(children), " ", -1);
+            for (gchar **child = child_pids; *child; ++child)
+            {
+                if (**child)
+                    pids.emplace_back(*child);
+            }
+            g_strfreev(child_pids);
+            g_free(children);
+        }
+        g_dir_close(tasks);
+    }
+    return total;
+}
+
 void BrowserLauncherTest::stopBrowser()
 {
     if (!_launcher)
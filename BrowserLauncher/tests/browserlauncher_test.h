@@ -71,7 +71,6 @@ private:
     void createMainLoop();
     void stopMainLoopAndServer();
     void createServer(unsigned port);
-    void stopBrowser();
     void breakIfNeeded();
     void createCompositor();
     void destroyCompositor();
@@ -120,6 +119,10 @@ protected:
     void sendFireboltMessage(const json& message) { sendMessage(_firebolt_connection, message); }
     void sendTestMessage(const json& message) { sendMessage(_test_connection, message); }
     void launchBrowser(const std::string& url, std::vector<std::string> args = { });
+    void prewarmBrowser(std::vector<std::string> args = { });
+    void adoptPrewarmedBrowser(const std::string& url);
+    void stopBrowser();
+    long browserPeakRssKb() const;
     bool runUntil(
         std::function<bool()> && pred,
         const std::chrono::milliseconds timeout,
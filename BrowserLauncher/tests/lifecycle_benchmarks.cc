@@ -0,0 +1,192 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "browserlauncher_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <vector>
+
+// Launch and lifecycle latencies measured over a number of iterations on the test harness.
+//
+//   BROWSER_LAUNCHER_BENCHMARK_ITERATIONS  iterations to run (default 5)
+//   BROWSER_LAUNCHER_BENCHMARK_OUTPUT      where to write the JSON report
+//                                          (default browser_launcher_benchmarks.json)
+//
+// Each iteration cold launches the browser and walks it through resume-to-active, hide / show and
+// suspend / resume; latencies are measured from the Firebolt state change being sent until the page
+// reports the matching page lifecycle state; the harness breaks the event loop on every websocket
+// message, so the wait adds no polling delay. Peak RSS covers the launcher and its web processes.
+
+namespace {
+
+unsigned iterationCount()
+{
+    const char *value = g_getenv("BROWSER_LAUNCHER_BENCHMARK_ITERATIONS");
+    const unsigned long count = value ? strtoul(value, nullptr, 10) : 0;
+    return count > 0 ? static_cast<unsigned>(count) : 5;
+}
+
+std::string outputPath()
+{
+    const char *value = g_getenv("BROWSER_LAUNCHER_BENCHMARK_OUTPUT");
+    return (value && *value) ? value : "browser_launcher_benchmarks.json";
+}
+
+// min / median / P95 (nearest rank) of the samples
+json summarize(std::vector<double> samples)
+{
+    if (samples.empty())
+        return { {"samples", 0} };
+
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](double percentile) {
+        const size_t index = static_cast<size_t>(std::ceil(percentile * samples.size()));
+        return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+    return {
+        {"samples", samples.size()},
+        {"min", samples.front()},
+        {"median", rank(0.5)},
+        {"p95", rank(0.95)},
+        {"max", samples.back()}
+    };
+}
+
+class LifecycleBenchmark : public BrowserLauncherTest
+{
+protected:
+    void onTestMessage(const json& message) override
+    {
+        if (message.value("method", "") == "LifecycleTest.onStateChanged")
+            _page_state = message["params"].value("newState", "");
+    }
+
+    void resetBrowserState()
+    {
+        _state_change_listeners.clear();
+        _current_lc_state = LifecycleState::INITIALIZING;
+        _close_type.clear();
+        _focused = false;
+        _first_frame_ts = -1;
+        _first_request_ts = -1;
+        _frame_count = 0;
+        _page_state = "initializing";
+    }
+
+    // Sends the Firebolt state change and returns ms until the page reported `pageState`, or -1.
+    double measureTransition(LifecycleState newState, bool focused, const std::string& pageState)
+    {
+        const gint64 start = g_get_monotonic_time();
+        changeLifecycleStateState(_current_lc_state, newState, focused);
+        if (!runUntil([this, pageState] { return _page_state == pageState; }, 5s))
+        {
+            ADD_FAILURE() << "timed out waiting for page state " << pageState;
+            return -1;
+        }
+        return (g_get_monotonic_time() - start) / 1000.0;
+    }
+
+    void record(const char *name, double ms)
+    {
+        if (ms >= 0)
+            _samples[name].push_back(ms);
+    }
+
+    std::string _page_state { "initializing" };
+    std::map<std::string, std::vector<double>> _samples;
+    std::vector<double> _peak_rss_kb;
+};
+
+}  // namespace
+
+TEST_F(LifecycleBenchmark, LaunchAndLifecycle)
+{
+    const unsigned iterations = iterationCount();
+    const std::string url { gchar_ptr(g_strdup_printf("http://127.0.0.1:%u/tests/page_lifecycle.html", kTestServerPort)).get() };
+
+    for (unsigned i = 0; i < iterations && !HasFailure(); ++i)
+    {
+        g_message("benchmark iteration %u / %u", i + 1, iterations);
+        resetBrowserState();
+
+        // cold launch, until the page is active
+        {
+            const gint64 start = g_get_monotonic_time();
+            launchBrowser(url);
+            bool timed_out = !runUntil([this] {
+                return _firebolt_connection != nullptr && _state_change_listeners.size() > 0;
+            }, 10s);
+            ASSERT_FALSE(timed_out) << "timed out waiting for browser launcher";
+
+            changeLifecycleStateState(LifecycleState::INITIALIZING, LifecycleState::ACTIVE, true);
+            timed_out = !runUntil([this] {
+                return _test_connection != nullptr && _page_state == "active";
+            }, 10s);
+            ASSERT_FALSE(timed_out) << "timed out waiting for the page to become active";
+            record("cold_launch_to_active_ms", (g_get_monotonic_time() - start) / 1000.0);
+            if (_first_frame_ts != -1)
+                record("cold_launch_to_first_frame_ms", (_first_frame_ts - start) / 1000.0);
+        }
+
+        record("hide_ms", measureTransition(LifecycleState::PAUSED, false, "hidden"));
+        record("show_ms", measureTransition(LifecycleState::ACTIVE, true, "active"));
+
+        measureTransition(LifecycleState::PAUSED, false, "hidden");
+        record("suspend_ms", measureTransition(LifecycleState::SUSPENDED, false, "frozen"));
+        record("resume_ms", measureTransition(LifecycleState::PAUSED, false, "hidden"));
+
+        measureTransition(LifecycleState::SUSPENDED, false, "frozen");
+        record("resume_to_active_ms", measureTransition(LifecycleState::ACTIVE, true, "active"));
+
+        _peak_rss_kb.push_back(browserPeakRssKb());
+
+        // shut down and wait for both sockets to go away before the next launch
+        changeLifecycleStateState(_current_lc_state, LifecycleState::TERMINATING);
+        runUntil([this] { return !_close_type.empty(); }, 1s);
+        stopBrowser();
+        runUntil([this] { return _firebolt_connection == nullptr && _test_connection == nullptr; }, 2s);
+    }
+
+    json metrics = json::object();
+    for (const auto& [name, samples] : _samples)
+        metrics[name] = summarize(samples);
+
+    const json report = {
+        {"iterations", iterations},
+        {"compositor",
+#if defined(HAVE_WESTEROS_COMPOSITOR)
+            true
+#else
+            false
+#endif
+        },
+        {"metrics", metrics},
+        {"peak_rss_kb", summarize(_peak_rss_kb)}
+    };
+
+    const std::string path = outputPath();
+    std::ofstream output(path);
+    output << report.dump(2) << std::endl;
+    EXPECT_TRUE(output.good()) << "failed to write " << path;
+
+    g_message("benchmark results (%s): %s", path.c_str(), report.dump().c_str());
+}
@@ -261,6 +261,64 @@ TEST_P(LifecycleStateTest, LaunchToActive)
     EXPECT_EQ(_page_state, "terminated");
 }
 
+TEST_P(LifecycleStateTest, PrewarmedLaunch)
+{
+    // start browser parked on about:blank
+    prewarmBrowser({"--enableNonCompositedWebGL", GetParam() ? "true" : "false"});
+
+    // a pre-warmed browser doesn't connect nor load anything until adopted
+    {
+        bool connected = runUntil([this] {
+            return _firebolt_connection != nullptr || _first_request_ts != -1;
+        }, 3s);
+        EXPECT_FALSE(connected) << "pre-warmed browser connected before launch";
+    }
+
+    // adopt it and measure until the page reports its initial state
+    const gint64 launch_ts = g_get_monotonic_time();
+    adoptPrewarmedBrowser(
+        gchar_ptr(g_strdup_printf("http://127.0.0.1:%u/tests/page_lifecycle.html", kTestServerPort)).get());
+    {
+        bool timed_out = !runUntil([this] {
+            return
+                _firebolt_connection != nullptr &&
+                _test_connection != nullptr &&
+                _state_change_listeners.size() > 0;
+        }, 5s);
+        EXPECT_FALSE(timed_out) << "timed out waiting for browser launcher";
+    }
+
+    EXPECT_NE(_firebolt_connection, nullptr);
+    EXPECT_EQ(_state_change_listeners.size(), 1);
+
+    {
+        bool focused = true;
+        const auto oldState = LifecycleState::INITIALIZING;
+        const auto newState = LifecycleState::ACTIVE;
+        const std::string pageState = toPageLifecycleState(newState, focused);
+
+        changeLifecycleStateState(oldState, newState, focused);
+
+        bool timed_out = !runUntil([this, pageState] {
+            return _test_connection != nullptr && _page_state == pageState;
+        }, 1s);
+        EXPECT_EQ(_page_state, pageState);
+        EXPECT_FALSE(timed_out) << "timed out awaiting for initial page state change";
+    }
+
+    g_message("pre-warmed launch to active took %" G_GINT64_FORMAT " ms", (g_get_monotonic_time() - launch_ts) / 1000);
+
+    // attempt to shutdown browser gracefully
+    changeLifecycleStateState(_current_lc_state, LifecycleState::TERMINATING);
+    {
+        runUntil([this] {
+            return _page_state == "terminated" && !_close_type.empty();
+        }, 1s);
+    }
+    EXPECT_EQ(_close_type, "unload");
+    EXPECT_EQ(_page_state, "terminated");
+}
+
 TEST_P(LifecycleStateTest, ResumeToActive)
 {
     // launch browser
@@ -0,0 +1,189 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <array>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Fixed memory, log-linear bucketed histogram (HDR style). Values below 2^SubBucketBits are
+    // counted exactly, above that every power of two is split into 2^(SubBucketBits-1) equal
+    // buckets, so any recorded value is reported with a relative error of at most ~6%.
+    // Recording is O(1) and never allocates, the complete uint64_t range fits in ~4KB.
+    class Histogram {
+    public:
+        static constexpr uint8_t SubBucketBits = 5;
+        static constexpr uint16_t SubBucketHalf = (1 << (SubBucketBits - 1));
+        static constexpr uint16_t Buckets = ((64 - SubBucketBits + 2) * SubBucketHalf);
+
+        struct Summary {
+            uint64_t Count;
+            uint64_t Min;
+            uint64_t Max;
+            uint64_t Mean;
+            uint64_t P50;
+            uint64_t P90;
+            uint64_t P95;
+            uint64_t P99;
+        };
+
+    public:
+        Histogram()
+            : _counts()
+            , _count(0)
+            , _min(~0ULL)
+            , _max(0)
+            , _sum(0)
+        {
+            _counts.fill(0);
+        }
+        ~Histogram() = default;
+
+        Histogram(const Histogram&) = default;
+        Histogram& operator=(const Histogram&) = default;
+
+    public:
+        void Record(const uint64_t value)
+        {
+            uint32_t& counter = _counts[Index(value)];
+
+            // Saturate rather than wrap, a bucket holding 4G samples will not be the deciding one.
+            if (counter != ~0U) {
+                ++counter;
+                ++_count;
+                _sum += value;
+                _min = (value < _min ? value : _min);
+                _max = (value > _max ? value : _max);
+            }
+        }
+        void Reset()
+        {
+            _counts.fill(0);
+            _count = 0;
+            _min = ~0ULL;
+            _max = 0;
+            _sum = 0;
+        }
+        uint64_t Count() const
+        {
+            return (_count);
+        }
+        uint64_t Percentile(const double percentile) const
+        {
+            uint64_t result = 0;
+
+            if (_count != 0) {
+                const uint64_t target = Rank(percentile);
+                uint64_t seen = 0;
+                uint16_t index = 0;
+
+                while ((index < (Buckets - 1)) && ((seen + _counts[index]) < target)) {
+                    seen += _counts[index];
+                    ++index;
+                }
+                result = Clamp(HighestEquivalent(index));
+            }
+
+            return (result);
+        }
+        void Summarize(Summary& summary) const
+        {
+            summary.Count = _count;
+            summary.Min = (_count != 0 ? _min : 0);
+            summary.Max = _max;
+            summary.Mean = (_count != 0 ? (_sum / _count) : 0);
+            summary.P50 = 0;
+            summary.P90 = 0;
+            summary.P95 = 0;
+            summary.P99 = 0;
+
+            if (_count != 0) {
+                // One pass over the buckets for all reported percentiles, the ranks are ascending.
+                uint64_t* const results[] = { &summary.P50, &summary.P90, &summary.P95, &summary.P99 };
+                const uint64_t ranks[] = { Rank(50.0), Rank(90.0), Rank(95.0), Rank(99.0) };
+                uint8_t next = 0;
+                uint64_t seen = 0;
+
+                for (uint16_t index = 0; (index < Buckets) && (next < (sizeof(ranks) / sizeof(ranks[0]))); ++index) {
+                    seen += _counts[index];
+
+                    while ((next < (sizeof(ranks) / sizeof(ranks[0]))) && (seen >= ranks[next])) {
+                        *(results[next]) = Clamp(HighestEquivalent(index));
+                        ++next;
+                    }
+                }
+            }
+        }
+
+    private:
+        static uint16_t Index(const uint64_t value)
+        {
+            uint16_t result;
+
+            if (value < (1ULL << SubBucketBits)) {
+                result = static_cast<uint16_t>(value);
+            } else {
+                const uint8_t magnitude = static_cast<uint8_t>(63 - __builtin_clzll(value));
+                const uint8_t shift = magnitude - (SubBucketBits - 1);
+                const uint16_t mantissa = static_cast<uint16_t>(value >> shift);
+
+                result = ((shift + 1) * SubBucketHalf) + (mantissa - SubBucketHalf);
+            }
+
+            return (result);
+        }
+        static uint64_t HighestEquivalent(const uint16_t index)
+        {
+            uint64_t result;
+
+            if (index < (1 << SubBucketBits)) {
+                result = index;
+            } else {
+                const uint8_t shift = static_cast<uint8_t>((index / SubBucketHalf) - 1);
+                const uint64_t mantissa = (index % SubBucketHalf) + SubBucketHalf;
+
+                result = ((mantissa + 1) << shift) - 1;
+            }
+
+            return (result);
+        }
+        uint64_t Rank(const double percentile) const
+        {
+            uint64_t result = static_cast<uint64_t>(((percentile * _count) / 100.0) + 0.5);
+            return (result == 0 ? 1 : (result > _count ? _count : result));
+        }
+        uint64_t Clamp(const uint64_t value) const
+        {
+            return (value < _min ? _min : (value > _max ? _max : value));
+        }
+
+    private:
+        std::array<uint32_t, Buckets> _counts;
+        uint64_t _count;
+        uint64_t _min;
+        uint64_t _max;
+        uint64_t _sum;
+    };
+
+}
+}
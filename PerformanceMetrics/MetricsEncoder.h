@@ -0,0 +1,208 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <array>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Writes one flat metrics record straight into two preallocated buffers: as a JSON object
+    // ({"name":value,...}, numbers unquoted) for the log and as a JSON array holding every value
+    // as a string (["value",...]) for telemetry. Fields are emitted in the order they are added.
+    // The telemetry array is positional, so a record that does not fit is dropped as a whole:
+    // once a field fails every later Add() is ignored and Close() returns false.
+    class MetricsEncoder {
+    public:
+        static constexpr uint16_t BufferSize = 2048;
+
+    private:
+        class Buffer {
+        public:
+            Buffer()
+                : _data()
+                , _length(0)
+            {
+                _data[0] = '\0';
+            }
+
+        public:
+            void Clear()
+            {
+                _length = 0;
+                _data[0] = '\0';
+            }
+            uint16_t Length() const
+            {
+                return (_length);
+            }
+            const char* Data() const
+            {
+                return (_data.data());
+            }
+            // One character and the terminating NUL are always kept free for Close().
+            bool Append(const char character)
+            {
+                bool result = (_length < (BufferSize - 2));
+
+                if (result == true) {
+                    _data[_length++] = character;
+                    _data[_length] = '\0';
+                }
+
+                return (result);
+            }
+            bool Append(const char text[], const size_t length)
+            {
+                bool result = (length < static_cast<size_t>(BufferSize - 1 - _length));
+
+                if (result == true) {
+                    ::memcpy(&(_data[_length]), text, length);
+                    _length += static_cast<uint16_t>(length);
+                    _data[_length] = '\0';
+                }
+
+                return (result);
+            }
+            void Terminate(const char character)
+            {
+                _data[_length++] = character;
+                _data[_length] = '\0';
+            }
+            bool AppendQuoted(const char text[], const size_t length)
+            {
+                bool result = Append('"');
+
+                for (size_t index = 0; (result == true) && (index < length); ++index) {
+                    const char c = text[index];
+
+                    if ((c == '"') || (c == '\\')) {
+                        result = Append('\\') && Append(c);
+                    } else if (static_cast<uint8_t>(c) < 0x20) {
+                        char escaped[8];
+                        const int size = ::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<uint8_t>(c));
+                        result = Append(escaped, static_cast<size_t>(size));
+                    } else {
+                        result = Append(c);
+                    }
+                }
+
+                return (result && Append('"'));
+            }
+
+        private:
+            std::array<char, BufferSize> _data;
+            uint16_t _length;
+        };
+
+    public:
+        MetricsEncoder(const MetricsEncoder&) = delete;
+        MetricsEncoder& operator=(const MetricsEncoder&) = delete;
+
+        MetricsEncoder()
+            : _object()
+            , _array()
+            , _fields(0)
+            , _complete(true)
+        {
+            Clear();
+        }
+        ~MetricsEncoder() = default;
+
+    public:
+        void Clear()
+        {
+            _object.Clear();
+            _array.Clear();
+            _object.Append('{');
+            _array.Append('[');
+            _fields = 0;
+            _complete = true;
+        }
+        void Add(const TCHAR name[], const string& value)
+        {
+            Add(name, value.c_str(), value.length());
+        }
+        void Add(const TCHAR name[], const char value[])
+        {
+            Add(name, value, ::strlen(value));
+        }
+        void Add(const TCHAR name[], const char value[], const size_t length)
+        {
+            if (_complete == true) {
+                if ((Name(name) && _object.AppendQuoted(value, length) && Separator(_array) && _array.AppendQuoted(value, length)) == false) {
+                    _complete = false;
+                } else {
+                    ++_fields;
+                }
+            }
+        }
+        void Add(const TCHAR name[], const uint64_t value)
+        {
+            if (_complete == true) {
+                char number[24];
+                const size_t length = static_cast<size_t>(::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value)));
+
+                if ((Name(name) && _object.Append(number, length) && Separator(_array) && _array.AppendQuoted(number, length)) == false) {
+                    _complete = false;
+                } else {
+                    ++_fields;
+                }
+            }
+        }
+        // The object and array text, only complete after Close(). Returns false if a field did
+        // not fit, the record then holds a partial set of fields and must not be emitted.
+        bool Close()
+        {
+            _object.Terminate('}');
+            _array.Terminate(']');
+
+            return (_complete);
+        }
+        const char* Object() const
+        {
+            return (_object.Data());
+        }
+        const char* Array() const
+        {
+            return (_array.Data());
+        }
+
+    private:
+        bool Separator(Buffer& buffer)
+        {
+            return ((_fields == 0) || buffer.Append(','));
+        }
+        bool Name(const TCHAR name[])
+        {
+            return (Separator(_object) && _object.AppendQuoted(name, ::strlen(name)) && _object.Append(':'));
+        }
+
+    private:
+        Buffer _object;
+        Buffer _array;
+        uint16_t _fields;
+        bool _complete;
+    };
+
+}
+}
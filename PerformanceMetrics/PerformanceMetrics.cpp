@@ -49,10 +49,10 @@ namespace Plugin {
             result = _T("Both callsign and classname set to observe for metrics");
         }
         else if( ( config.ObservableCallsign.IsSet() == true ) && ( config.ObservableCallsign.Value().empty() == false ) ) {
-            _handler.reset(new CallsignPerfMetricsHandler(config.ObservableCallsign.Value()));
+            _handler.reset(new CallsignPerfMetricsHandler(config.ObservableCallsign.Value(), config.SummaryInterval.Value()));
         }
         else if( ( config.ObservableClassname.IsSet() == true ) && ( config.ObservableClassname.Value().empty() == false ) ) {
-            _handler.reset(new ClassnamePerfMetricsHandler(config.ObservableClassname.Value()));
+            _handler.reset(new ClassnamePerfMetricsHandler(config.ObservableClassname.Value(), config.SummaryInterval.Value()));
         } else {
             result = _T("No callsign or classname set to observe for metrics");
         }
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "Module.h"
+#include "Histogram.h"
 #include <interfaces/IMemory.h>
 #include <interfaces/IBrowser.h>
 
@@ -41,14 +42,17 @@ namespace Plugin {
                 : Core::JSON::Container()
                 , ObservableCallsign()
                 , ObservableClassname()
+                , SummaryInterval(3600)
             {
                 Add(_T("callsign"), &ObservableCallsign);
                 Add(_T("classname"), &ObservableClassname);
+                Add(_T("summaryinterval"), &SummaryInterval);
             }
 
         public:
             Core::JSON::String ObservableCallsign;
             Core::JSON::String ObservableClassname;
+            Core::JSON::DecUInt32 SummaryInterval; // seconds between two percentile summaries
         };
 
         class Notification : public PluginHost::IPlugin::INotification {
@@ -94,11 +98,100 @@ namespace Plugin {
 
     public:
 
+        // Distributions kept per observed callsign, they outlive a single activation of the observed
+        // plugin so launch related metrics accumulate over launches. The logger decides when and how
+        // to output them, Flush hands out the collected set and starts a new interval.
+        class MetricsHistograms {
+        public:
+            enum metric : uint8_t {
+                LAUNCH_TIME,
+                LOAD_TIME,
+                SUSPENDED_TIME,
+                RESUMED_TIME,
+                RSS_AT_LOAD,
+                NUMBER_OF_METRICS
+            };
+
+            using Set = std::array<Histogram, NUMBER_OF_METRICS>;
+
+        public:
+            MetricsHistograms(const MetricsHistograms&) = delete;
+            MetricsHistograms& operator=(const MetricsHistograms&) = delete;
+
+            explicit MetricsHistograms(const uint32_t interval_s)
+                : _histograms()
+                , _interval(static_cast<uint64_t>(interval_s) * Core::Time::MicroSecondsPerSecond)
+                , _intervalStart(Core::Time::Now().Ticks())
+                , _adminLock()
+            {
+            }
+            ~MetricsHistograms() = default;
+
+        public:
+            static const TCHAR* Name(const metric which)
+            {
+                static const TCHAR* const names[NUMBER_OF_METRICS] = {
+                    _T("LaunchTime_ms"),
+                    _T("LoadTime_ms"),
+                    _T("SuspendedTime_ms"),
+                    _T("ResumedTime_ms"),
+                    _T("RSSAtLoad_kB")
+                };
+                return (which < NUMBER_OF_METRICS ? names[which] : _T("Unknown"));
+            }
+
+            // Length of a summary interval in milliseconds, 0 if every flush is due.
+            uint64_t Interval() const
+            {
+                return (_interval / Core::Time::TicksPerMillisecond);
+            }
+
+            void Record(const metric which, const uint64_t value)
+            {
+                ASSERT(which < NUMBER_OF_METRICS);
+
+                _adminLock.Lock();
+                _histograms[which].Record(value);
+                _adminLock.Unlock();
+            }
+
+            // Returns true and moves the collected histograms into the given set if the summary
+            // interval expired (or force is set) and there is anything to report.
+            bool Flush(Set& histograms, const bool force)
+            {
+                bool result = false;
+                const uint64_t now = Core::Time::Now().Ticks();
+
+                _adminLock.Lock();
+                if ( ( force == true ) || ( ( now - _intervalStart ) >= _interval ) ) {
+                    for (const Histogram& histogram : _histograms) {
+                        result = result || ( histogram.Count() != 0 );
+                    }
+                    if (result == true) {
+                        histograms = _histograms;
+                        for (Histogram& histogram : _histograms) {
+                            histogram.Reset();
+                        }
+                        _intervalStart = now;
+                    }
+                }
+                _adminLock.Unlock();
+
+                return (result);
+            }
+
+        private:
+            Set _histograms;
+            uint64_t _interval;
+            uint64_t _intervalStart;
+            mutable Core::CriticalSection _adminLock;
+        };
+
         class IBasicMetricsLogger {
         public:
             virtual ~IBasicMetricsLogger() = default;
 
-            virtual void Enable(PluginHost::IShell& service, const string& callsign) = 0;
+            virtual void Enable(PluginHost::IShell& service, const string& callsign, MetricsHistograms& histograms) = 0;
             virtual void Disable() = 0;
 
             virtual void Activated()  = 0;
@@ -149,10 +242,11 @@ namespace Plugin {
         class CallsignPerfMetricsHandler : public IPerfMetricsHandler
         {
         public:
-            CallsignPerfMetricsHandler(const string& callsign) 
+            CallsignPerfMetricsHandler(const string& callsign, const uint32_t summaryinterval_s) 
                 : IPerfMetricsHandler()
                 , _callsign(callsign)
                 , _observable()
+                , _histograms(summaryinterval_s)
             {
             }
 
@@ -169,6 +263,16 @@ namespace Plugin {
                 return _callsign;
             }
 
+            MetricsHistograms& Histograms()
+            {
+                return _histograms;
+            }
+
+            bool IsActive() const
+            {
+                return (_observable.IsValid() == true);
+            }
+
             void Initialize() override
             {
                 ASSERT(_observable.IsValid() == false);
@@ -228,14 +332,16 @@ namespace Plugin {
         private:
             string _callsign;
             Core::ProxyType<IObservable> _observable;
+            MetricsHistograms _histograms;
         };
 
         class ClassnamePerfMetricsHandler : public IPerfMetricsHandler
         {
         public:
-            ClassnamePerfMetricsHandler(const string& classname) 
+            ClassnamePerfMetricsHandler(const string& classname, const uint32_t summaryinterval_s) 
                 : IPerfMetricsHandler()
                 , _classname(classname)
+                , _summaryinterval(summaryinterval_s)
                 , _observers()
                 , _adminLock()
             {
@@ -272,12 +378,15 @@ namespace Plugin {
             {
                 if( service.ClassName() == Classname() ) {
                     _adminLock.Lock();
+                    // Handlers are kept after a deactivation so the histograms survive relaunches of the same callsign
                     auto result =_observers.emplace(std::piecewise_construct,
                                        std::forward_as_tuple(service.Callsign()),
-                                       std::forward_as_tuple(service.Callsign()));
-                    ASSERT( ( result.second == true ) && ( result.first != _observers.end() ) );
-                    if( result.first != _observers.end() && result.second == true ) {
+                                       std::forward_as_tuple(service.Callsign(), _summaryinterval));
+                    ASSERT( result.first != _observers.end() );
+                    if( result.second == true ) {
                         result.first->second.Initialize();
+                    }
+                    if( result.first->second.IsActive() == false ) {
                         result.first->second.Activated(service);
                     } else {
                         TRACE(Trace::Error, (_T("Observer for callsign %s already exists, ignoring duplicate activation"), service.Callsign().c_str()));
@@ -292,8 +401,6 @@ namespace Plugin {
                     auto it =_observers.find(service.Callsign());
                     if( it != _observers.end() ) {
                         it->second.Deactivated(service);
-                        it->second.Deinitialize();
-                        _observers.erase(it);
                     }
                     _adminLock.Unlock();
                 }
@@ -303,6 +410,7 @@ namespace Plugin {
             using OberserverMap = std::unordered_map<string, CallsignPerfMetricsHandler>;
 
             string _classname;
+            uint32_t _summaryinterval;
             OberserverMap _observers;
             mutable Core::CriticalSection _adminLock;
         };
@@ -362,7 +470,7 @@ namespace Plugin {
                 ASSERT(_service != nullptr);
                 ASSERT(_service->Callsign() == Parent().Callsign());
 
-                Logger().Enable(*_service, Parent().Callsign());
+                Logger().Enable(*_service, Parent().Callsign(), Parent().Histograms());
             }
             void Disable() override
             {
@@ -0,0 +1,164 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <array>
+
+#include <fcntl.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Collects the system and process figures reported with a page load in one go, cheap enough
+    // for the navigation path: the system wide values come from a single sysinfo(2) call, the
+    // process statm file is kept open and re-read with pread(2) into a fixed buffer. Nothing is
+    // allocated and no stream is involved while sampling.
+    class ProcSampler {
+    public:
+        static constexpr uint16_t StatmBufferSize = 128;
+
+        struct Sample {
+            uint64_t Total; // bytes
+            uint64_t Free; // bytes
+            uint64_t Swapped; // bytes
+            uint64_t Uptime; // seconds
+            std::array<uint64_t, 3> Load; // scaled by 1 << SI_LOAD_SHIFT
+            uint64_t Resident; // bytes, from statm
+            char Statm[StatmBufferSize]; // the raw statm line, without the newline
+            uint16_t StatmLength;
+        };
+
+    public:
+        ProcSampler(const ProcSampler&) = delete;
+        ProcSampler& operator=(const ProcSampler&) = delete;
+
+        ProcSampler()
+            : _adminLock()
+            , _pid(0)
+            , _statm(-1)
+        {
+        }
+        ~ProcSampler()
+        {
+            Close();
+        }
+
+    public:
+        // Fills in the system figures and, if pid is not 0, the statm figures of that process.
+        // Returns false if the system figures could not be read.
+        bool Take(Sample& sample, const uint32_t pid)
+        {
+            struct sysinfo info;
+            bool result = (::sysinfo(&info) == 0);
+
+            if (result == true) {
+                sample.Total = static_cast<uint64_t>(info.totalram) * info.mem_unit;
+                sample.Free = static_cast<uint64_t>(info.freeram) * info.mem_unit;
+                sample.Swapped = static_cast<uint64_t>(info.totalswap - info.freeswap) * info.mem_unit;
+                sample.Uptime = info.uptime;
+                sample.Load[0] = info.loads[0];
+                sample.Load[1] = info.loads[1];
+                sample.Load[2] = info.loads[2];
+            }
+
+            sample.Resident = 0;
+            sample.Statm[0] = '\0';
+            sample.StatmLength = 0;
+
+            if (pid != 0) {
+                _adminLock.Lock();
+                ReadStatm(sample, pid);
+                _adminLock.Unlock();
+            }
+
+            return (result);
+        }
+        void Close()
+        {
+            _adminLock.Lock();
+            if (_statm != -1) {
+                ::close(_statm);
+                _statm = -1;
+            }
+            _pid = 0;
+            _adminLock.Unlock();
+        }
+
+    private:
+        bool Open(const uint32_t pid)
+        {
+            if (_statm != -1) {
+                ::close(_statm);
+            }
+
+            char path[32];
+            ::snprintf(path, sizeof(path), "/proc/%u/statm", pid);
+
+            _statm = ::open(path, O_RDONLY | O_CLOEXEC);
+            _pid = (_statm != -1 ? pid : 0);
+
+            return (_statm != -1);
+        }
+        void ReadStatm(Sample& sample, const uint32_t pid)
+        {
+            if ((pid != _pid) && (Open(pid) == false)) {
+                return;
+            }
+
+            ssize_t length = ::pread(_statm, sample.Statm, sizeof(sample.Statm) - 1, 0);
+
+            if (length <= 0) {
+                // The process went away or the pid got recycled, give a fresh descriptor one go.
+                if (Open(pid) == true) {
+                    length = ::pread(_statm, sample.Statm, sizeof(sample.Statm) - 1, 0);
+                }
+            }
+
+            if (length > 0) {
+                while ((length > 0) && (sample.Statm[length - 1] == '\n')) {
+                    --length;
+                }
+                sample.Statm[length] = '\0';
+                sample.StatmLength = static_cast<uint16_t>(length);
+
+                // second field is the resident set in pages
+                const char* field = sample.Statm;
+                while ((*field != '\0') && (*field != ' ')) {
+                    ++field;
+                }
+                static const uint64_t pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+                sample.Resident = ::strtoull(field, nullptr, 10) * pageSize;
+            } else {
+                sample.Statm[0] = '\0';
+            }
+        }
+
+    private:
+        Core::CriticalSection _adminLock;
+        uint32_t _pid;
+        int _statm;
+    };
+
+}
+}
@@ -19,10 +19,12 @@
  
 #include "Module.h"
 #include "PerformanceMetrics.h"
+#include "ProcSampler.h"
+#include "MetricsEncoder.h"
 
+#include <algorithm>
 #include <utility>
 #include <array>
-#include <fstream>
 #include <string>
 
 #include "UtilsTelemetry.h"
@@ -37,6 +39,8 @@ class SysLogOuput : public PerformanceMetrics::IBrowserMetricsLogger {
 private:
 
     static constexpr char webProcessName[] = _T("WPEWebProcess");
+    // Keeps a long URL from pushing the launch metrics record out of the encoder buffer
+    static constexpr size_t maxAppNameLength = 512;
 
     class URLLoadedMetrics {
     public:
@@ -174,74 +178,6 @@ private:
             COLD
         };
 
-    private:
-
-    class MetricsAsJson : public Core::JSON::Container {
-        public:
-
-            MetricsAsJson()
-                : Core::JSON::Container()
-                , Mode(ModeType::WARM)
-                , AppType()
-                , MemoryTotal()
-                , MemoryFree()
-                , MemorySwapped()
-                , Uptime()
-                , LoadAvarage()
-                , NbrProcessors()
-                , ProcessRSS()
-                , ProcessPID()
-                , Appname()
-                , StatmLine()
-                , IdleTime()
-                , LaunchTime()
-                , LoadSuccess()
-                , NbrLoaded()
-                , Callsign()
-            {
-                Add(_T("LaunchState"), &Mode);
-                Add(_T("AppType"), &AppType);
-                Add(_T("MemTotal"), &MemoryTotal);
-                Add(_T("MemFree"), &MemoryFree);
-                Add(_T("MemSwapped"), &MemorySwapped);
-                Add(_T("Uptime"), &Uptime);
-                Add(_T("LoadAvg"), &LoadAvarage);
-                Add(_T("NProc"), &NbrProcessors);
-                Add(_T("ProcessRSS"), &ProcessRSS);
-                Add(_T("ProcessPID"), &ProcessPID);
-                Add(_T("AppName"), &Appname);
-                Add(_T("webProcessStatmLine"), &StatmLine);
-                Add(_T("webProcessIdleTime"), &IdleTime);
-                Add(_T("LaunchTime"), &LaunchTime);
-                Add(_T("AppLoadSuccess"), &LoadSuccess);
-                Add(_T("webPageLoadNum"), &NbrLoaded);
-                Add(_T("CallSign"), &Callsign);
-            }
-            ~MetricsAsJson() override = default;
-
-            MetricsAsJson(const MetricsAsJson&) = delete;
-            MetricsAsJson& operator=(const MetricsAsJson&) = delete;
-
-        public:
-            Core::JSON::EnumType<ModeType> Mode;
-            Core::JSON::String AppType;
-            Core::JSON::DecUInt64 MemoryTotal;
-            Core::JSON::DecUInt64 MemoryFree;
-            Core::JSON::DecUInt64 MemorySwapped;
-            Core::JSON::DecUInt64 Uptime;
-            Core::JSON::String LoadAvarage;
-            Core::JSON::DecUInt32 NbrProcessors;
-            Core::JSON::DecUInt64 ProcessRSS;
-            Core::JSON::DecUInt32 ProcessPID;
-            Core::JSON::String Appname;
-            Core::JSON::String StatmLine;
-            Core::JSON::DecUInt32 IdleTime;
-            Core::JSON::DecUInt64 LaunchTime;
-            Core::JSON::DecUInt8 LoadSuccess; // kept backwards compatibility, use 0 and 1 instead of bool
-            Core::JSON::DecUInt32 NbrLoaded;
-            Core::JSON::String Callsign;
-    };
-
 public:
     SysLogOuput(const SysLogOuput&) = delete;
     SysLogOuput& operator=(const SysLogOuput&) = delete;
@@ -252,14 +188,20 @@ public:
         , _service(nullptr)
         , _memory(nullptr)
         , _processmemory(nullptr)
+        , _histograms(nullptr)
         , _cold(true)
         , _urloadmetrics()
         , _timeIdleFirstStart(0)
         , _timePluginStart(0)
+        , _timeStateChange(0)
+        , _launched(false)
         , _adminLock()
         , _lastURL()
         , _didLogLaunchMetrics(false)
         , _lastLoggedApp()
+        , _sampler()
+        , _encoder()
+        , _summaryJob(*this)
         {
         }
     ~SysLogOuput() override
@@ -268,12 +210,16 @@ public:
         ASSERT(_processmemory == nullptr);
     }
 
-    void Enable(PluginHost::IShell& service, const string& callsign) override 
+    void Enable(PluginHost::IShell& service, const string& callsign, PerformanceMetrics::MetricsHistograms& histograms) override 
     {
         ASSERT(_memory == nullptr);
         ASSERT(_processmemory == nullptr);
 
         _callsign = callsign;
+        _histograms = &histograms;
+        if( histograms.Interval() != 0 ) {
+            _summaryJob.Reschedule(Core::Time::Now().Add(static_cast<uint32_t>(histograms.Interval())));
+        }
         _service = &service;
         _service->AddRef();
         _memory = service.QueryInterface<Exchange::IMemory>();
@@ -299,6 +245,7 @@ public:
 
     void Disable() override 
     {
+        _summaryJob.Revoke();
         if(_service != nullptr) {
             _service->Release();
             _service = nullptr;
@@ -311,16 +258,23 @@ public:
             _processmemory->Release();
             _processmemory = nullptr;
         }
+        _histograms = nullptr;
+        _sampler.Close();
     }
 
     void Activated() 
     {
         _timeIdleFirstStart = Core::Time::Now().Ticks();
         _timePluginStart = Core::Time::Now().Ticks();
+        _timeStateChange = 0;
+        _launched = false;
     }
 
     void Deactivated(const uint32_t) override 
     {
+        // the histograms outlive this activation, but what was collected so far is reported now
+        OutputSummaries(true);
+
         PluginHost::IShell::reason reason = _service->Reason();
         if(reason == PluginHost::IShell::FAILURE || reason == PluginHost::IShell::MEMORY_EXCEEDED)
         {
@@ -338,11 +292,13 @@ public:
 
     void Resumed() override
     {
+        RecordStateChange(PerformanceMetrics::MetricsHistograms::SUSPENDED_TIME);
     }
 
     void Suspended() override
     {
         _timeIdleFirstStart = Core::Time::Now().Ticks();
+        RecordStateChange(PerformanceMetrics::MetricsHistograms::RESUMED_TIME);
     }
 
     string getHostName(string _URL){
@@ -374,12 +330,23 @@ public:
             URLLoadedMetrics metrics(_urloadmetrics);
             _adminLock.Unlock();
                         
-            uint64_t urllaunchtime_ms = ( ( Core::Time::Now().Ticks() - metrics.StartLoad() ) / Core::Time::TicksPerMillisecond);
+            const uint64_t now = Core::Time::Now().Ticks();
+            uint64_t urllaunchtime_ms = ( ( now - metrics.StartLoad() ) / Core::Time::TicksPerMillisecond);
+
+            if( _histograms != nullptr ) {
+                if( _launched == false ) {
+                    _histograms->Record(PerformanceMetrics::MetricsHistograms::LAUNCH_TIME, ( now - _timePluginStart ) / Core::Time::TicksPerMillisecond);
+                    _launched = true;
+                }
+                _histograms->Record(PerformanceMetrics::MetricsHistograms::LOAD_TIME, urllaunchtime_ms);
+                _histograms->Record(PerformanceMetrics::MetricsHistograms::RSS_AT_LOAD, metrics.RSSMemProcess() / 1024);
+            }
 
             if(strcmp(getHostName(URL).c_str(), _lastLoggedApp.c_str()))
                 _didLogLaunchMetrics = false;
 
             OutputLoadFinishedMetrics(metrics, getHostName(URL), urllaunchtime_ms, success, totalloaded);
+            OutputSummaries(false);
 
             _timeIdleFirstStart = 0; // we only measure on first non about:blank url handling
         }
@@ -389,23 +356,34 @@ public:
     {
         if( URL != startURL ) {
             URLLoadedMetrics metrics;
-            Core::SystemInfo::MemorySnapshot snapshot = Core::SystemInfo::Instance().TakeMemorySnapshot();
-            metrics.Total(snapshot.Total());
-            metrics.Free(snapshot.Free());
-            metrics.Swapped(snapshot.SwapTotal()-snapshot.SwapFree());
-            metrics.Uptime(Core::SystemInfo::Instance().GetUpTime());
-            metrics.AverageLoad()[0] = Core::SystemInfo::Instance().GetCpuLoadAvg()[0];
-            metrics.AverageLoad()[1] = Core::SystemInfo::Instance().GetCpuLoadAvg()[1];
-            metrics.AverageLoad()[2] = Core::SystemInfo::Instance().GetCpuLoadAvg()[2];
 
-            uint64_t resident = 0;
+            uint32_t pid = 0;
             if( _processmemory != nullptr ) {
-                resident = _processmemory->Resident();
-                uint32_t pid = _processmemory->Identifier();
-                if( pid != 0 && pid < PID_MAX_LIMIT ) {
-                    metrics.StatmLine(GetProcessStatmLine(pid));
+                pid = _processmemory->Identifier();
+                if( pid >= PID_MAX_LIMIT ) {
+                    pid = 0;
                 }
-            } else if ( _memory != nullptr ) {
+            }
+
+            ProcSampler::Sample sample;
+            if( _sampler.Take(sample, pid) == true ) {
+                metrics.Total(sample.Total);
+                metrics.Free(sample.Free);
+                metrics.Swapped(sample.Swapped);
+                metrics.Uptime(sample.Uptime);
+                metrics.AverageLoad()[0] = sample.Load[0];
+                metrics.AverageLoad()[1] = sample.Load[1];
+                metrics.AverageLoad()[2] = sample.Load[2];
+            }
+
+            // the web process RSS comes with its statm line, only ask over COM-RPC without one
+            uint64_t resident = 0;
+            if( sample.StatmLength != 0 ) {
+                metrics.StatmLine(string(sample.Statm, sample.StatmLength));
+                resident = sample.Resident;
+            } else if( _processmemory != nullptr ) {
+                resident = _processmemory->Resident();
+            } else if( _memory != nullptr ) {
                 resident = _memory->Resident();
             }
 
@@ -432,6 +410,45 @@ public:
     {
     }
 private:
+    void RecordStateChange(const PerformanceMetrics::MetricsHistograms::metric which)
+    {
+        const uint64_t now = Core::Time::Now().Ticks();
+
+        if( ( _histograms != nullptr ) && ( _timeStateChange != 0 ) ) {
+            _histograms->Record(which, ( now - _timeStateChange ) / Core::Time::TicksPerMillisecond);
+            OutputSummaries(false);
+        }
+        _timeStateChange = now;
+    }
+
+    // Summaries are due every summary interval, also when the observed plugin sits idle
+    void Dispatch()
+    {
+        ASSERT(_histograms != nullptr);
+
+        OutputSummaries(false);
+        _summaryJob.Reschedule(Core::Time::Now().Add(static_cast<uint32_t>(_histograms->Interval())));
+    }
+
+    void OutputSummaries(const bool force)
+    {
+        PerformanceMetrics::MetricsHistograms::Set histograms;
+
+        if( ( _histograms != nullptr ) && ( _histograms->Flush(histograms, force) == true ) ) {
+            for( uint8_t index = 0; index < PerformanceMetrics::MetricsHistograms::NUMBER_OF_METRICS; ++index ) {
+                Histogram::Summary summary;
+                histograms[index].Summarize(summary);
+
+                if( summary.Count != 0 ) {
+                    SYSLOG(Logging::Notification, (_T("%s %s n=%llu min=%llu p50=%llu p90=%llu p95=%llu p99=%llu max=%llu mean=%llu"),
+                        _callsign.c_str(),
+                        PerformanceMetrics::MetricsHistograms::Name(static_cast<PerformanceMetrics::MetricsHistograms::metric>(index)),
+                        summary.Count, summary.Min, summary.P50, summary.P90, summary.P95, summary.P99, summary.Max, summary.Mean));
+                }
+            }
+        }
+    }
+
     void OutputLoadFinishedMetrics(const URLLoadedMetrics& urloadedmetrics, 
                                    const string& URL, 
                                    const uint64_t urllaunchtime_ms,
@@ -441,84 +458,75 @@ private:
         if(_didLogLaunchMetrics)
             return;
 
-        MetricsAsJson output;
-
-        output.Mode = ( urloadedmetrics.IsColdLaunch() == true ? ModeType::COLD : ModeType::WARM );
-        output.AppType = _T("Web");
-        output.MemoryTotal = urloadedmetrics.Total()/(1024);
-        output.MemoryFree = urloadedmetrics.Free()/(1024);
-        output.MemorySwapped = urloadedmetrics.Swapped()/(1024);
-        output.Uptime = urloadedmetrics.Uptime();
-
         static const float LA_SCALE = static_cast<float>(1 << SI_LOAD_SHIFT);
-        output.LoadAvarage = std::to_string(urloadedmetrics.AverageLoad()[0] / LA_SCALE).substr(0,4) + " " +
-                             std::to_string(urloadedmetrics.AverageLoad()[1] / LA_SCALE).substr(0,4) + " " +
-                             std::to_string(urloadedmetrics.AverageLoad()[2] / LA_SCALE).substr(0,4);
-
         static const long NPROC_ONLN = sysconf(_SC_NPROCESSORS_ONLN);
-        output.NbrProcessors = NPROC_ONLN;
 
-        output.ProcessRSS = urloadedmetrics.RSSMemProcess();
+        // Same format as before: each average printed with %f and cut to 4 characters.
+        char loadAverage[3 * 5];
+        uint8_t loadLength = 0;
+        for( uint8_t index = 0; index < URLLoadedMetrics::nbrAvgCpuMeasurement; ++index ) {
+            char average[32];
+            ::snprintf(average, sizeof(average), "%f", urloadedmetrics.AverageLoad()[index] / LA_SCALE);
+            loadLength += ::snprintf(&(loadAverage[loadLength]), sizeof(loadAverage) - loadLength, (index == 0 ? "%.4s" : " %.4s"), average);
+        }
 
         uint32_t pid = 0;
         if( _processmemory != nullptr ) {
             pid = _processmemory->Identifier();
         }
-        output.ProcessPID = pid;
-
-        output.Appname = URL;
-        output.StatmLine = urloadedmetrics.StatmLine();
-        output.IdleTime = urloadedmetrics.IdleTime();
-        output.LaunchTime = urllaunchtime_ms;
-        output.LoadSuccess = success;
-        output.NbrLoaded = totalloaded;
-        output.Callsign = _callsign;
-
-        string outputstring;
-        output.ToString(outputstring);
-        JsonArray array;
-        JsonObject const metrics(outputstring);
-        JsonObject::Iterator it = metrics.Variants();
-        while (it.Next()) {
-            array.Add(it.Current().String().c_str());
-        }
-        string eventValue;
-        array.ToString(eventValue);
 
-        string eventName("LaunchMetrics_accum");
-
-        Utils::Telemetry::sendMessage((char *)eventName.c_str(), (char *)eventValue.c_str());
-
-	SYSLOG(Logging::Notification, (_T( "%s Launch Metrics: %s "), _callsign.c_str(), outputstring.c_str()));
+        _encoder.Clear();
+        _encoder.Add(_T("LaunchState"), Core::EnumerateType<ModeType>( urloadedmetrics.IsColdLaunch() == true ? ModeType::COLD : ModeType::WARM ).Data());
+        _encoder.Add(_T("AppType"), _T("Web"));
+        _encoder.Add(_T("MemTotal"), urloadedmetrics.Total()/(1024));
+        _encoder.Add(_T("MemFree"), urloadedmetrics.Free()/(1024));
+        _encoder.Add(_T("MemSwapped"), urloadedmetrics.Swapped()/(1024));
+        _encoder.Add(_T("Uptime"), urloadedmetrics.Uptime());
+        _encoder.Add(_T("LoadAvg"), loadAverage, loadLength);
+        _encoder.Add(_T("NProc"), static_cast<uint64_t>(NPROC_ONLN));
+        _encoder.Add(_T("ProcessRSS"), urloadedmetrics.RSSMemProcess());
+        _encoder.Add(_T("ProcessPID"), static_cast<uint64_t>(pid));
+        _encoder.Add(_T("AppName"), URL.c_str(), std::min(URL.length(), maxAppNameLength));
+        _encoder.Add(_T("webProcessStatmLine"), urloadedmetrics.StatmLine());
+        _encoder.Add(_T("webProcessIdleTime"), urloadedmetrics.IdleTime());
+        _encoder.Add(_T("LaunchTime"), urllaunchtime_ms);
+        _encoder.Add(_T("AppLoadSuccess"), static_cast<uint64_t>(success ? 1 : 0)); // kept backwards compatibility, use 0 and 1 instead of bool
+        _encoder.Add(_T("webPageLoadNum"), static_cast<uint64_t>(totalloaded));
+        _encoder.Add(_T("CallSign"), _callsign);
+        if (_encoder.Close() == true) {
+            string eventName("LaunchMetrics_accum");
+
+            Utils::Telemetry::sendMessage((char *)eventName.c_str(), const_cast<char*>(_encoder.Array()));
+
+            SYSLOG(Logging::Notification, (_T( "%s Launch Metrics: %s "), _callsign.c_str(), _encoder.Object()));
+        } else {
+            SYSLOG(Logging::Error, (_T( "%s Launch Metrics do not fit in %u bytes, not reported"), _callsign.c_str(), MetricsEncoder::BufferSize));
+        }
         _didLogLaunchMetrics = true;
         _lastLoggedApp = URL;
     }
 
-    string GetProcessStatmLine(const uint32_t pid) 
-    {
-        string statmLine;
-        std::string procPath = std::string("/proc/") + std::to_string(pid) + "/statm";
-        std::ifstream statmStream(procPath);
-        if (statmStream.is_open() ) {
-            std::getline(statmStream, statmLine);
-            statmStream.close();
-        }
-        return  statmLine;
-    }
-
 private:
     string _callsign;
     PluginHost::IShell* _service;
     Exchange::IMemory* _memory;
     Exchange::IProcessMemory* _processmemory;
+    PerformanceMetrics::MetricsHistograms* _histograms;
     bool _cold;
     URLLoadedMetrics _urloadmetrics;
     Core::Time::microsecondsfromepoch _timeIdleFirstStart;
     Core::Time::microsecondsfromepoch _timePluginStart;
+    Core::Time::microsecondsfromepoch _timeStateChange;
+    bool _launched;
     mutable Core::CriticalSection _adminLock;
     string _lastURL;
     bool _didLogLaunchMetrics;
     string _lastLoggedApp;
+    ProcSampler _sampler;
+    MetricsEncoder _encoder;
+
+    friend Core::ThreadPool::JobType<SysLogOuput&>;
+    Core::WorkerPool::JobType<SysLogOuput&> _summaryJob;
 };
 
 constexpr char SysLogOuput::webProcessName[];
@@ -81,7 +81,7 @@ public:
         ASSERT(_memory == nullptr);
     }
 
-    void Enable(PluginHost::IShell& service, const string& callsign) override 
+    void Enable(PluginHost::IShell& service, const string& callsign, PerformanceMetrics::MetricsHistograms&) override 
     {
         ASSERT(_memory == nullptr);
 
@@ -144,7 +144,7 @@ public:
         ASSERT(_memory == nullptr);
     }
 
-    void Enable(PluginHost::IShell& service, const string& callsign) override 
+    void Enable(PluginHost::IShell& service, const string& callsign, PerformanceMetrics::MetricsHistograms&) override 
     {
         _callsign = callsign;
         _memory = service.QueryInterface<Exchange::IMemory>();
@@ -21,6 +21,7 @@
 
 #include <sstream>
 #include <iterator>
+#include <set>
 #include <algorithm>
 
 #include <glib.h>
@@ -37,6 +38,17 @@ namespace Plugin {
 
 namespace {
 
+// First line of a delta payload: "@delta <base sequence> <sequence>", followed by
+// "-<cookie>" and "+<cookie>" records. In delta mode a full snapshot starts with
+// "@snapshot <sequence>", anything else is a snapshot without a sequence.
+static const char deltaTag[] = "@delta ";
+static const char snapshotTag[] = "@snapshot ";
+
+static bool hasTag(const std::vector<std::string>& records, const char tag[], const size_t length)
+{
+    return !records.empty() && records.front().compare(0, length, tag) == 0;
+}
+
 static std::string serialize(const std::vector<std::string>& cookies)
 {
     std::ostringstream os;
@@ -44,6 +56,58 @@ static std::string serialize(const std::vector<std::string>& cookies)
     return os.str();
 }
 
+static std::string serializeSnapshot(const uint32_t sequence, const std::vector<std::string>& cookies)
+{
+    std::ostringstream os;
+    os << snapshotTag << sequence << '\n';
+    std::copy(cookies.begin(), cookies.end(), std::ostream_iterator<std::string>(os, "\n"));
+    return os.str();
+}
+
+static std::string serializeDelta(const uint32_t base, const uint32_t sequence, const std::vector<std::string>& added, const std::vector<std::string>& removed)
+{
+    std::ostringstream os;
+    os << deltaTag << base << ' ' << sequence << '\n';
+    for (const auto& cookie : removed)
+        os << '-' << cookie << '\n';
+    for (const auto& cookie : added)
+        os << '+' << cookie << '\n';
+    return os.str();
+}
+
+static bool isDelta(const std::vector<std::string>& records)
+{
+    return hasTag(records, deltaTag, sizeof(deltaTag) - 1);
+}
+
+static bool isSnapshot(const std::vector<std::string>& records)
+{
+    return hasTag(records, snapshotTag, sizeof(snapshotTag) - 1);
+}
+
+// Reads "<base> <sequence>" of a delta header, or "<sequence>" of a snapshot header
+static bool parseHeader(const std::string& header, const size_t tagLength, uint32_t* base, uint32_t& sequence)
+{
+    std::istringstream is(header.substr(tagLength));
+    if (base != nullptr)
+        is >> *base;
+    is >> sequence;
+    return !is.fail();
+}
+
+static void applyDelta(const std::vector<std::string>& records, std::vector<std::string>& cookies)
+{
+    std::set<std::string> jar(cookies.begin(), cookies.end());
+    for (auto record = std::next(records.begin()); record != records.end(); ++record)
+    {
+        if ((*record)[0] == '-')
+            jar.erase(record->substr(1));
+        else if ((*record)[0] == '+')
+            jar.insert(record->substr(1));
+    }
+    cookies.assign(jar.begin(), jar.end());
+}
+
 static void deserialize(const std::string& cookies, std::vector<std::string>& result)
 {
     std::string cookie;
@@ -188,13 +252,11 @@ struct CookieJar::CookieJarPrivate
 {
     CookieJarCrypto _cookieJarCrypto;
 
-    uint32_t Pack(const std::vector<std::string> &cookies, uint32_t& version, uint32_t& checksum, string& payload)
+    uint32_t Pack(const std::string& serialized, uint32_t& version, uint32_t& checksum, string& payload)
     {
         uint32_t rc;
-        std::string serialized;
         std::vector<uint8_t> encrypted;
 
-        serialized = serialize(cookies);
         checksum = crc_checksum(serialized);
 
         rc = _cookieJarCrypto.Encrypt(compress(serialized), version, encrypted);
@@ -253,7 +315,35 @@ CookieJar::~CookieJar() = default;
 
 uint32_t CookieJar::Pack(uint32_t& version, uint32_t& checksum, string& payload) const
 {
-    return _priv->Pack(_cookies, version, checksum, payload);
+    uint32_t rc;
+
+    if (!_delta)
+    {
+        rc = _priv->Pack(serialize(_cookies), version, checksum, payload);
+    }
+    else
+    {
+        std::vector<std::string> added;
+        std::vector<std::string> removed;
+
+        if (_based)
+        {
+            std::set_difference(_baseCookies.begin(), _baseCookies.end(), _cookies.begin(), _cookies.end(), std::back_inserter(removed));
+            std::set_difference(_cookies.begin(), _cookies.end(), _baseCookies.begin(), _baseCookies.end(), std::back_inserter(added));
+        }
+
+        // A snapshot once the records would not be smaller than the jar itself
+        if (!_based || (added.size() + removed.size()) >= _cookies.size())
+        {
+            rc = _priv->Pack(serializeSnapshot(_sequence, _cookies), version, checksum, payload);
+        }
+        else
+        {
+            rc = _priv->Pack(serializeDelta(_baseSequence, _sequence, added, removed), version, checksum, payload);
+        }
+    }
+
+    return rc;
 }
 
 uint32_t CookieJar::Unpack(const uint32_t version, const uint32_t checksum, const string& payload)
@@ -264,8 +354,49 @@ uint32_t CookieJar::Unpack(const uint32_t version, const uint32_t checksum, cons
     rc = _priv->Unpack(version, checksum, payload, cookies);
 
     if (rc == WPEFramework::Core::ERROR_NONE) {
-        _cookies = std::move(cookies);
-        _refreshed.SetState( false );
+        uint32_t base = 0;
+        // a payload without a sequence still starts a new base
+        uint32_t sequence = _sequence + 1;
+
+        if (isDelta(cookies)) {
+            if (!parseHeader(cookies.front(), sizeof(deltaTag) - 1, &base, sequence)) {
+                TRACE_GLOBAL(Trace::Error,(_T("Malformed cookie jar delta header")));
+                rc = Core::ERROR_BAD_REQUEST;
+            }
+            // Only the state the delta was taken against can take it, anything else needs a snapshot
+            else if (!_based || base != _baseSequence) {
+                TRACE_GLOBAL(Trace::Error,(_T("Cookie jar delta %u..%u does not apply to %u, need a snapshot"), base, sequence, _baseSequence));
+                rc = Core::ERROR_ILLEGAL_STATE;
+            }
+            else {
+                std::vector<std::string> jar(_baseCookies);
+                applyDelta(cookies, jar);
+                cookies = std::move(jar);
+            }
+        }
+        else if (isSnapshot(cookies)) {
+            if (!parseHeader(cookies.front(), sizeof(snapshotTag) - 1, nullptr, sequence)) {
+                TRACE_GLOBAL(Trace::Error,(_T("Malformed cookie jar snapshot header")));
+                rc = Core::ERROR_BAD_REQUEST;
+            }
+            else {
+                cookies.erase(cookies.begin());
+                std::sort(cookies.begin(), cookies.end());
+            }
+        }
+        else {
+            std::sort(cookies.begin(), cookies.end());
+        }
+
+        if (rc == WPEFramework::Core::ERROR_NONE) {
+            // Whoever handed this payload in has stored this state, later deltas are taken against it
+            _cookies = std::move(cookies);
+            _baseCookies = _cookies;
+            _based = true;
+            _sequence = sequence;
+            _baseSequence = sequence;
+            _refreshed.SetState( false );
+        }
     }
 
     return rc;
@@ -273,6 +404,11 @@ uint32_t CookieJar::Unpack(const uint32_t version, const uint32_t checksum, cons
 
 void CookieJar::SetCookies(std::vector<std::string> && cookies)
 {
+    std::sort(cookies.begin(), cookies.end());
+
+    if (cookies != _cookies)
+        ++_sequence;
+
     _cookies = std::move(cookies);
     _refreshed.SetState( true );
 }
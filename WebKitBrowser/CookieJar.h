@@ -42,6 +42,14 @@ public:
     void SetCookies(std::vector<std::string> &&);
     std::vector<std::string> GetCookies() const;
 
+    // In delta mode Pack carries the cookies added/removed since the base, the state last
+    // handed in through Unpack. Packing does not move the base, reading the jar twice or not
+    // storing a payload breaks nothing. Without a base, or when the delta would outgrow the jar,
+    // Pack returns a full snapshot. Unpack refuses a delta that was not taken against the base
+    // with ERROR_ILLEGAL_STATE, the caller has to provide a snapshot instead.
+    void DeltaMode(const bool enabled) { _delta = enabled; RequestSnapshot(); }
+    void RequestSnapshot() { _based = false; }
+
     // Pack/unack cookies for storing in the "cloud"
     uint32_t Pack(uint32_t& version, uint32_t& checksum, string& payload) const;
     uint32_t Unpack(const uint32_t version, const uint32_t checksum, const string& payload);
@@ -50,6 +58,12 @@ private:
     Core::StateTrigger<bool> _refreshed { false };
     std::vector<std::string> _cookies;
 
+    bool _delta { false };
+    bool _based { false };
+    uint32_t _sequence { 0 };
+    uint32_t _baseSequence { 0 };
+    std::vector<std::string> _baseCookies;
+
     struct CookieJarPrivate;
     mutable std::unique_ptr<CookieJarPrivate> _priv;
 };
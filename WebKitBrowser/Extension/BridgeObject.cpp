@@ -51,43 +51,101 @@ const char kBadgerEventSrc[] = R"jssrc(
 })
 )jssrc";
 
-static void CallBridge(WebKitWebPage* page, const char* scriptSrc, WebKitUserMessage* message)
+// Reply/event dispatch functions compiled for the page's current JS context. They are
+// attached to the WebKitWebPage and dropped whenever the window object is cleared.
+static const char kDispatchFunctionsKey[] = "wpe-bridge-dispatch-functions";
+
+struct DispatchFunctions {
+    JSCContext* context;
+    JSCValue* reply;
+    JSCValue* event;
+};
+
+static void DestroyDispatchFunctions(gpointer data)
 {
-    GVariant* payload;
-    const char* payloadPtr;
+    DispatchFunctions* functions = static_cast<DispatchFunctions*>(data);
+    g_clear_object(&functions->event);
+    g_clear_object(&functions->reply);
+    g_clear_object(&functions->context);
+    g_free(functions);
+}
 
-    payload = webkit_user_message_get_parameters(message);
-    if (!payload) {
-        return;
+static JSCValue* GetDispatchFunction(WebKitWebPage* page, JSCContext* jsContext, const char* scriptSrc)
+{
+    DispatchFunctions* functions = static_cast<DispatchFunctions*>(g_object_get_data(G_OBJECT(page), kDispatchFunctionsKey));
+
+    if ((functions == nullptr) || (functions->context != jsContext)) {
+        functions = g_new0(DispatchFunctions, 1);
+        functions->context = JSC_CONTEXT(g_object_ref(jsContext));
+        functions->reply = jsc_context_evaluate(jsContext, kBadgerReplySrc, -1);
+        functions->event = jsc_context_evaluate(jsContext, kBadgerEventSrc, -1);
+        g_object_set_data_full(G_OBJECT(page), kDispatchFunctionsKey, functions, DestroyDispatchFunctions);
     }
-    g_variant_get(payload, "&s", &payloadPtr);
 
-    gsize decodedLen = 0;
-    gchar *decoded = reinterpret_cast<gchar*>(g_base64_decode(payloadPtr, &decodedLen));
-    if (g_utf8_validate(decoded, decodedLen, nullptr) == FALSE) {
+    return (scriptSrc == kBadgerReplySrc ? functions->reply : functions->event);
+}
+
+// Set when the browser sends bridge payloads as plain text in a byte array ("ay")
+// instead of base64 encoded strings. Queries are sent back in the same form.
+static bool _rawMessages = false;
+
+static GBytes* MakeValidUTF8(gchar* text, gsize length)
+{
+    if (g_utf8_validate(text, length, nullptr) == FALSE) {
         TRACE_GLOBAL(Trace::Error, (_T("Decoded message is not a valid UTF8 string!")));
-        gchar *tmp = decoded;
+        gchar *tmp = text;
 #if GLIB_CHECK_VERSION(2, 52, 0)
-        decoded = g_utf8_make_valid(tmp, decodedLen);
+        text = g_utf8_make_valid(tmp, length);
 #else
-        decoded = g_strdup("[Invalid UTF-8]");
+        text = g_strdup("[Invalid UTF-8]");
 #endif
         g_free(tmp);
-        decodedLen = strlen(decoded);
+        length = strlen(text);
+    }
+    return g_bytes_new_take(text, length);
+}
+
+static GBytes* DecodePayload(GVariant* payload)
+{
+    if (g_variant_is_of_type(payload, G_VARIANT_TYPE_BYTESTRING) == TRUE) {
+        GBytes* bytes = g_variant_get_data_as_bytes(payload);
+        gsize length = 0;
+        const gchar* text = static_cast<const gchar*>(g_bytes_get_data(bytes, &length));
+        if (g_utf8_validate(text, length, nullptr) == TRUE) {
+            return bytes;
+        }
+        g_bytes_unref(bytes);
+        return MakeValidUTF8(g_strndup(text, length), length);
+    }
+
+    const char* payloadPtr;
+    g_variant_get(payload, "&s", &payloadPtr);
+
+    gsize decodedLen = 0;
+    gchar *decoded = reinterpret_cast<gchar*>(g_base64_decode(payloadPtr, &decodedLen));
+    return MakeValidUTF8(decoded, decodedLen);
+}
+
+static void CallBridge(WebKitWebPage* page, const char* scriptSrc, WebKitUserMessage* message)
+{
+    GVariant* payload;
+
+    payload = webkit_user_message_get_parameters(message);
+    if (!payload) {
+        return;
     }
 
     WebKitFrame* frame = webkit_web_page_get_main_frame(page);
     JSCContext* jsContext = webkit_frame_get_js_context(frame);
 
-    GBytes *payloadBytes = g_bytes_new_take(decoded, decodedLen);
+    GBytes *payloadBytes = DecodePayload(payload);
     JSCValue *payloadVal = jsc_value_new_string_from_bytes(jsContext, payloadBytes);
     g_bytes_unref(payloadBytes);
 
-    JSCValue* script = jsc_context_evaluate(jsContext, scriptSrc, -1);
+    JSCValue* script = GetDispatchFunction(page, jsContext, scriptSrc);
     JSCValue* ignore = jsc_value_function_call(script, JSC_TYPE_VALUE, payloadVal, G_TYPE_NONE);
 
     g_object_unref(ignore);
-    g_object_unref(script);
     g_object_unref(payloadVal);
     g_object_unref(jsContext);
 }
@@ -95,10 +153,15 @@ static void CallBridge(WebKitWebPage* page, const char* scriptSrc, WebKitUserMes
 static void OnBridgeQuery(const char* arg, gpointer userData)
 {
     WebKitWebPage* page = reinterpret_cast<WebKitWebPage*>(userData);
-    gchar *b64string = g_base64_encode(reinterpret_cast<const guchar*>(arg), strlen(arg));
+    GVariant* body;
+    if (_rawMessages == true) {
+        body = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, arg, strlen(arg), sizeof(gchar));
+    } else {
+        gchar *b64string = g_base64_encode(reinterpret_cast<const guchar*>(arg), strlen(arg));
+        body = g_variant_new_take_string(b64string);
+    }
     webkit_web_page_send_message_to_view(page,
-            webkit_user_message_new(Tags::BridgeObjectQuery,
-                    g_variant_new_take_string(b64string)), nullptr, nullptr, nullptr);
+            webkit_user_message_new(Tags::BridgeObjectQuery, body), nullptr, nullptr, nullptr);
 }
 
 static JSCValue* OnCreateBridgeObject(gpointer userData)
@@ -119,6 +182,9 @@ void InjectJS(WebKitScriptWorld* world, WebKitWebPage* page, WebKitFrame* frame)
     if (webkit_frame_is_main_frame(frame) == false)
         return;
 
+    // New global object, the compiled dispatch functions refer to the old one.
+    g_object_set_data(G_OBJECT(page), kDispatchFunctionsKey, nullptr);
+
     JSCContext* jsContext = webkit_frame_get_js_context_for_script_world(frame, world);
 
     JSCValue* script = jsc_context_evaluate(jsContext, kServiceManagerSrc, -1);
@@ -135,6 +201,11 @@ void InjectJS(WebKitScriptWorld* world, WebKitWebPage* page, WebKitFrame* frame)
     g_object_unref(jsContext);
 }
 
+void Initialize(bool rawMessages)
+{
+    _rawMessages = rawMessages;
+}
+
 bool HandleMessageToPage(WebKitWebPage* page, const char* messageName, WebKitUserMessage* message)
 {
     if (g_strcmp0(messageName, Tags::BridgeObjectReply) == 0) {
@@ -25,6 +25,7 @@ namespace WPEFramework {
 namespace JavaScript {
 namespace BridgeObject {
 
+void Initialize(bool rawMessages);
 bool HandleMessageToPage(WebKitWebPage*, const char*, WebKitUserMessage*);
 void InjectJS(WebKitScriptWorld*, WebKitWebPage*, WebKitFrame*);
 
@@ -35,7 +35,16 @@ namespace
 {
 
 typedef std::vector<std::pair<std::string, std::string>> Headers;
-typedef std::unordered_map<WebKitWebPage*, Headers> PageHeaders;
+
+// The source JSON is kept next to the parsed headers, so resending the same set
+// skips the parsing.
+struct PageHeadersEntry
+{
+    string source;
+    Headers headers;
+};
+
+typedef std::unordered_map<WebKitWebPage*, PageHeadersEntry> PageHeaders;
 static PageHeaders s_pageHeaders;
 
 bool ParseHeaders(const string& json, Headers& out)
@@ -90,12 +99,20 @@ void SetRequestHeaders(WebKitWebPage* page, WebKitUserMessage* message)
         return;
     }
 
+    auto current = s_pageHeaders.find(page);
+    if ((current != s_pageHeaders.end()) && (current->second.source == headersStr)) {
+        TRACE_GLOBAL(Trace::Information, (_T("headers unchanged\n")));
+        return;
+    }
+
     Headers newHeaders;
     if (ParseHeaders(headersStr, newHeaders)) {
         if (newHeaders.empty()) {
             RemoveRequestHeaders(page);
         } else {
-            s_pageHeaders[page] = std::move(newHeaders);
+            PageHeadersEntry& entry = s_pageHeaders[page];
+            entry.source = std::move(headersStr);
+            entry.headers = std::move(newHeaders);
         }
     }
 }
@@ -110,7 +127,7 @@ void ApplyRequestHeaders(WebKitWebPage* page, WebKitURIRequest* request)
     if (!headers)
         return;
 
-    for (const auto& h : it->second) {
+    for (const auto& h : it->second.headers) {
         soup_message_headers_append(headers, h.first.c_str(), h.second.c_str());
     }
 }
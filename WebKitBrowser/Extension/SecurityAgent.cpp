@@ -19,6 +19,7 @@
 
 #include "Module.h"
 #include "SecurityAgent.h"
+#include "../SecurityTokenCache.h"
 
 #include <securityagent/securityagent.h>
 
@@ -26,11 +27,19 @@ namespace WPEFramework {
 namespace JavaScript {
 namespace SecurityAgent {
 
+static TokenCache _tokenCache;
+
 static char* thunderToken(gpointer userData)
 {
     WebKitFrame* frame = reinterpret_cast<WebKitFrame*>(userData);
     const char *uri = webkit_frame_get_uri(frame);
     if (uri) {
+        const std::string url(uri);
+        const std::string* cached = _tokenCache.Lookup(url);
+        if (cached != nullptr) {
+            return g_strndup(cached->c_str(), cached->length());
+        }
+
         uint8_t buffer[2 * 1024];
         size_t input_length = std::min ( strlen(uri), sizeof(buffer) );
 
@@ -39,6 +48,7 @@ static char* thunderToken(gpointer userData)
 
         int length = GetToken(static_cast<uint16_t>(sizeof(buffer)), input_length, buffer);
         if (length > 0) {
+            _tokenCache.Store(url, std::string(reinterpret_cast<const char*>(buffer), length));
             return g_strndup(reinterpret_cast<const char*>(buffer), length);
         }
     }
@@ -50,6 +60,9 @@ void InjectJS(WebKitScriptWorld* world, WebKitFrame* frame)
     if (webkit_frame_is_main_frame(frame) == false)
         return;
 
+    // A new document, tokens handed out to the previous one are not reused.
+    _tokenCache.Invalidate();
+
     JSCContext* jsContext = webkit_frame_get_js_context_for_script_world(frame, world);
     JSCValue* jsObject = jsc_value_new_object(jsContext, nullptr, nullptr);
     JSCValue* jsFunction = jsc_value_new_function(jsContext, nullptr, reinterpret_cast<GCallback>(thunderToken),
@@ -19,7 +19,9 @@
 
 #include "Module.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 #include <memory>
 #include <syslog.h>
 
@@ -64,6 +66,99 @@ static Core::NodeId GetConnectionNode()
     return (Core::NodeId(nodeName.c_str()));
 }
 
+// Rate limit in front of the per-message BrowserConsoleLog trace. Policy and limits are those of
+// the launcher's console log extension, see BrowserLauncher/src/wpewebkit/extensions/log/logextension.c.
+class ConsoleLogLimiter {
+private:
+    ConsoleLogLimiter(const ConsoleLogLimiter&) = delete;
+    ConsoleLogLimiter& operator=(const ConsoleLogLimiter&) = delete;
+
+    static constexpr uint32_t RatePerSecond = 200;
+    static constexpr uint32_t Burst = 400;
+
+    enum level : uint8_t {
+        LEVEL_ERROR,
+        LEVEL_WARNING,
+        LEVEL_LOG,
+        LEVEL_INFO,
+        LEVEL_DEBUG,
+        LEVEL_COUNT
+    };
+
+public:
+    ConsoleLogLimiter()
+        : _tokens(Burst)
+        , _refilled(0)
+        , _reported(0)
+        , _dropped()
+    {
+    }
+
+    bool Admit(const WebKitConsoleMessageLevel consoleLevel, const gint64 now)
+    {
+        const level index = Level(consoleLevel);
+        if (index == LEVEL_ERROR) {
+            return (true);
+        }
+
+        if (_refilled != 0) {
+            _tokens = std::min(static_cast<double>(Burst), _tokens + (((now - _refilled) * RatePerSecond) / static_cast<double>(G_USEC_PER_SEC)));
+        }
+        _refilled = now;
+
+        if (_tokens < 1.0) {
+            _dropped[index]++;
+            return (false);
+        }
+        _tokens -= 1.0;
+        return (true);
+    }
+
+    bool Report(const gint64 now, string& report)
+    {
+        uint32_t total = 0;
+        for (const uint32_t dropped : _dropped) {
+            total += dropped;
+        }
+        if ((total == 0) || ((now - _reported) < G_USEC_PER_SEC)) {
+            return (false);
+        }
+
+        report = "dropped " + Core::NumberType<uint32_t>(total).Text() + " console messages (warning:"
+            + Core::NumberType<uint32_t>(_dropped[LEVEL_WARNING]).Text() + " log:"
+            + Core::NumberType<uint32_t>(_dropped[LEVEL_LOG]).Text() + " info:"
+            + Core::NumberType<uint32_t>(_dropped[LEVEL_INFO]).Text() + " debug:"
+            + Core::NumberType<uint32_t>(_dropped[LEVEL_DEBUG]).Text() + ')';
+
+        std::fill(std::begin(_dropped), std::end(_dropped), 0);
+        _reported = now;
+        return (true);
+    }
+
+private:
+    static level Level(const WebKitConsoleMessageLevel consoleLevel)
+    {
+        switch (consoleLevel) {
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_ERROR:
+            return (LEVEL_ERROR);
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_WARNING:
+            return (LEVEL_WARNING);
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_INFO:
+            return (LEVEL_INFO);
+        case WEBKIT_CONSOLE_MESSAGE_LEVEL_DEBUG:
+            return (LEVEL_DEBUG);
+        default:
+            return (LEVEL_LOG);
+        }
+    }
+
+private:
+    double _tokens;
+    gint64 _refilled;
+    gint64 _reported;
+    uint32_t _dropped[LEVEL_COUNT];
+};
+
 static class PluginHost {
 private:
     PluginHost(const PluginHost&) = delete;
@@ -99,8 +194,9 @@ public:
 
         const char *uid;
         const char *whitelist;
+        gboolean rawBridgeMessages = FALSE;
 
-        g_variant_get((GVariant*) userData, "(&sm&sb)", &uid, &whitelist, &_logToSystemConsoleEnabled);
+        g_variant_get((GVariant*) userData, "(&sm&sbb)", &uid, &whitelist, &_logToSystemConsoleEnabled, &rawBridgeMessages);
 
         if (_logToSystemConsoleEnabled && Core::SystemInfo::GetEnvironment(string(_T("CLIENT_IDENTIFIER")), _consoleLogPrefix))
           _consoleLogPrefix = _consoleLogPrefix.substr(0, _consoleLogPrefix.find(','));
@@ -124,6 +220,10 @@ public:
             }
         }
 
+#if defined(ENABLE_BADGER_BRIDGE)
+        JavaScript::BridgeObject::Initialize(rawBridgeMessages);
+#endif
+
 #if defined(UPDATE_TZ_FROM_FILE)
         _tzSupport.Initialize();
 #endif
@@ -187,6 +287,16 @@ private:
     }
     static void consoleMessageSentCallback(VARIABLE_IS_NOT_USED WebKitWebPage* page, WebKitConsoleMessage* message, PluginHost* host)
     {
+        const gint64 now = g_get_monotonic_time();
+        if (host->_consoleLogLimiter.Admit(webkit_console_message_get_level(message), now) == false) {
+            return;
+        }
+
+        string report;
+        if (host->_consoleLogLimiter.Report(now, report) == true) {
+            TRACE_GLOBAL(BrowserConsoleLog, (host->_consoleLogPrefix, report, 0, 0));
+        }
+
         string messageString = Core::ToString(webkit_console_message_get_text(message));
         uint64_t line = static_cast<uint64_t>(webkit_console_message_get_line(message));
 
@@ -230,6 +340,7 @@ private:
 #endif
 
     string _consoleLogPrefix;
+    ConsoleLogLimiter _consoleLogLimiter;
     gboolean _logToSystemConsoleEnabled;
     WebKitWebExtension* _extension;
 } _wpeFrameworkClient;
@@ -20,6 +20,7 @@
 #include "JavaScriptFunctionType.h"
 #include "Utils.h"
 #include "../Tags.h"
+#include "../SecurityTokenCache.h"
 #include <securityagent/securityagent.h>
 
 namespace WPEFramework {
@@ -29,7 +30,10 @@ namespace JavaScript {
         public:
             token(const token&) = delete;
             token& operator= (const token&) = delete;
-            token() {
+            token()
+                : _cache()
+                , _url()
+            {
             }
             ~token() {
             }
@@ -47,14 +51,25 @@ namespace JavaScript {
 
                     std::string url = WebKit::Utils::GetURL();
 
+                    // The committed URL changed, so this is a new document.
+                    if (url != _url) {
+                        _cache.Invalidate();
+                        _url = url;
+                    }
+
                     std::string tokenAsString;
-                    if (url.length() < sizeof(buffer)) {
+                    const std::string* cached = _cache.Lookup(url);
+                    if (cached != nullptr) {
+                        tokenAsString = *cached;
+                    }
+                    else if (url.length() < sizeof(buffer)) {
                         ::memset (buffer, 0, sizeof(buffer));
                         ::memcpy (buffer, url.c_str(), url.length());
 
                         int length = GetToken(static_cast<uint16_t>(sizeof(buffer)), url.length(), buffer);
                         if (length > 0) {
                            tokenAsString = std::string(reinterpret_cast<const char*>(buffer), length);
+                           _cache.Store(url, tokenAsString);
                         }
                     }
 
@@ -66,6 +81,10 @@ namespace JavaScript {
 
                 return (result);
             }
+
+        private:
+            SecurityAgent::TokenCache _cache;
+            std::string _url;
         };
 
         static JavaScriptFunctionType<token> _instance(_T("thunder"));
@@ -0,0 +1,169 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace WPEFramework {
+namespace JavaScript {
+namespace SecurityAgent {
+
+    // Keeps the last token handed out to the page, so repeated thunder.token() calls are served
+    // without a COM-RPC round trip. The entry is bound to the origin it was issued for and lives
+    // until the next navigation (Invalidate), until the "exp" claim of the token (minus a margin)
+    // or at most MaxLifetime, whichever comes first. Only used from the web process main thread.
+    class TokenCache {
+    public:
+        static constexpr uint64_t MaxLifetime = 10 * 60 * 1000 * 1000ULL; // us
+        static constexpr uint64_t ExpiryMargin = 30 * 1000 * 1000ULL; // us
+
+    public:
+        TokenCache(const TokenCache&) = delete;
+        TokenCache& operator=(const TokenCache&) = delete;
+
+        TokenCache()
+            : _origin()
+            , _token()
+            , _expiry(0)
+        {
+        }
+        ~TokenCache() = default;
+
+    public:
+        const std::string* Lookup(const std::string& url)
+        {
+            const std::string* result = nullptr;
+
+            if ((_expiry != 0) && (Core::Time::Now().Ticks() < _expiry) && (Origin(url) == _origin)) {
+                result = &_token;
+            }
+
+            return (result);
+        }
+        void Store(const std::string& url, const std::string& token)
+        {
+            const uint64_t now = Core::Time::Now().Ticks();
+
+            _origin = Origin(url);
+            _token = token;
+            _expiry = now + MaxLifetime;
+
+            const uint64_t expires = Expires(token);
+            if (expires != 0) {
+                const uint64_t limit = (expires * 1000 * 1000ULL);
+                if (limit < (now + ExpiryMargin)) {
+                    _expiry = 0;
+                } else if ((limit - ExpiryMargin) < _expiry) {
+                    _expiry = limit - ExpiryMargin;
+                }
+            }
+        }
+        void Invalidate()
+        {
+            _origin.clear();
+            _token.clear();
+            _expiry = 0;
+        }
+
+    private:
+        // scheme://authority, anything without an authority is its own origin.
+        static std::string Origin(const std::string& url)
+        {
+            std::string result(url);
+            const size_t separator = url.find("://");
+
+            if (separator != std::string::npos) {
+                const size_t end = url.find_first_of("/?#", separator + 3);
+                if (end != std::string::npos) {
+                    result = url.substr(0, end);
+                }
+            }
+
+            return (result);
+        }
+        // The "exp" claim (seconds since epoch) of a JWT token, 0 if there is none.
+        static uint64_t Expires(const std::string& token)
+        {
+            uint64_t result = 0;
+            const size_t begin = token.find('.');
+            const size_t end = (begin != std::string::npos ? token.find('.', begin + 1) : std::string::npos);
+
+            if (end != std::string::npos) {
+                const std::string payload = Base64URLDecode(token.substr(begin + 1, end - begin - 1));
+                const size_t claim = payload.find("\"exp\"");
+
+                if (claim != std::string::npos) {
+                    const size_t colon = payload.find(':', claim + 5);
+                    if (colon != std::string::npos) {
+                        result = strtoull(payload.c_str() + colon + 1, nullptr, 10);
+                    }
+                }
+            }
+
+            return (result);
+        }
+        static std::string Base64URLDecode(const std::string& input)
+        {
+            std::string result;
+            uint32_t accumulator = 0;
+            uint8_t bits = 0;
+
+            result.reserve((input.length() * 3) / 4);
+
+            for (const char c : input) {
+                uint8_t value;
+
+                if ((c >= 'A') && (c <= 'Z')) {
+                    value = c - 'A';
+                } else if ((c >= 'a') && (c <= 'z')) {
+                    value = c - 'a' + 26;
+                } else if ((c >= '0') && (c <= '9')) {
+                    value = c - '0' + 52;
+                } else if ((c == '-') || (c == '+')) {
+                    value = 62;
+                } else if ((c == '_') || (c == '/')) {
+                    value = 63;
+                } else {
+                    break;
+                }
+
+                accumulator = (accumulator << 6) | value;
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    result += static_cast<char>((accumulator >> bits) & 0xFF);
+                }
+            }
+
+            return (result);
+        }
+
+    private:
+        std::string _origin;
+        std::string _token;
+        uint64_t _expiry;
+    };
+
+}  // SecurityAgent
+}  // JavaScript
+}  // WPEFramework
@@ -19,6 +19,11 @@
 
 #include "WebKitBrowser.h"
 
+#include <algorithm>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
 #define API_VERSION_NUMBER_MAJOR 1
 #define API_VERSION_NUMBER_MINOR 1
 #define API_VERSION_NUMBER_PATCH 16
@@ -378,11 +383,34 @@ namespace WebKitBrowser {
         MemoryObserverImpl& operator=(const MemoryObserverImpl&);
 
         enum { TYPICAL_STARTUP_TIME = 10 }; /* in Seconds */
+        enum { RESCAN_INTERVAL = 30 }; /* in Seconds */
+
+        struct Child {
+            Child(const pid_t id, const string& name)
+                : Id(id)
+                , Name(name)
+            {
+            }
+
+            pid_t Id;
+            string Name;
+        };
+
+        struct Usage {
+            uint64_t Allocated;
+            uint64_t Resident;
+            uint64_t Shared;
+        };
+
+        using Children = std::vector<Child>;
+
     public:
         MemoryObserverImpl(const RPC::IRemoteConnection* connection)
             : _main(connection == nullptr ? Core::ProcessInfo().Id() : connection->RemoteId())
-            , _children(_main.Id())
+            , _children()
+            , _nextScan(TimePoint::min())
             , _startTime(connection == nullptr ? (TimePoint::min()) : (SteadyClock::now() + std::chrono::seconds(TYPICAL_STARTUP_TIME)))
+            , _adminLock()
         { // IsOperation true till calculated time (microseconds)
         }
         ~MemoryObserverImpl()
@@ -392,68 +420,24 @@ namespace WebKitBrowser {
     public:
         uint64_t Resident() const override
         {
-            uint32_t result(0);
-            if (_startTime != TimePoint::min()) {
-                if (_children.Count() < RequiredChildren) {
-                    _children = Core::ProcessInfo::Iterator(_main.Id());
-                }
-
-                result = _main.Resident();
-
-                _children.Reset();
-
-                while (_children.Next() == true) {
-                    result += _children.Current().Resident();
-                }
-            }
-
-            return (result);
+            return (Measure().Resident);
         }
         uint64_t Allocated() const override
         {
-            uint32_t result(0);
-
-            if (_startTime != TimePoint::min()) {
-                if (_children.Count() < RequiredChildren) {
-                    _children = Core::ProcessInfo::Iterator(_main.Id());
-                }
-
-                result = _main.Allocated();
-
-                _children.Reset();
-
-                while (_children.Next() == true) {
-                    result += _children.Current().Allocated();
-                }
-            }
-
-            return (result);
+            return (Measure().Allocated);
         }
         uint64_t Shared() const override
         {
-            uint32_t result(0);
-
-            if (_startTime != TimePoint::min()) {
-                if (_children.Count() < RequiredChildren) {
-                    _children = Core::ProcessInfo::Iterator(_main.Id());
-                }
-
-                result = _main.Shared();
-
-                _children.Reset();
-
-                while (_children.Next() == true) {
-                    result += _children.Current().Shared();
-                }
-            }
-
-            return (result);
+            return (Measure().Shared);
         }
         uint8_t Processes() const override
         {
-            // Refresh the children list !!!
-            _children = Core::ProcessInfo::Iterator(_main.Id());
-            return ((_startTime == TimePoint::min()) || (_main.IsActive() == true) ? 1 : 0) + _children.Count();
+            _adminLock.Lock();
+            Refresh(Validate() == false);
+            uint8_t result = static_cast<uint8_t>(_children.size());
+            _adminLock.Unlock();
+
+            return ((_startTime == TimePoint::min()) || (_main.IsActive() == true) ? 1 : 0) + result;
         }
         const bool IsOperational() const override
         {
@@ -465,32 +449,26 @@ namespace WebKitBrowser {
                 // In the end we check if all bits are 0, what means all mandatory processes are still running.
                 requiredProcesses = (0xFFFFFFFF >> (32 - RequiredChildren));
 
-                if (_children.Count() < RequiredChildren) {
-                    // Refresh the children list !!!
-                    _children = Core::ProcessInfo::Iterator(_main.Id());
-                }
-                //!< If there are less children than in the the mandatoryProcesses struct, we are done and return false.
-                if (_children.Count() >= RequiredChildren) {
+                _adminLock.Lock();
 
-                    _children.Reset();
+                Refresh(Validate() == false);
 
-                    //!< loop over all child processes as long as we are operational.
-                    while ((requiredProcesses != 0) && (true == _children.Next())) {
+                //!< loop over all child processes as long as we are operational.
+                for (Children::const_iterator index = _children.begin(); (requiredProcesses != 0) && (index != _children.end()); ++index) {
 
-                        uint8_t count(0);
-                        string name(_children.Current().Name());
+                    uint8_t count(0);
 
-                        while ((count < RequiredChildren) && (name != mandatoryProcesses[count])) {
-                            ++count;
-                        }
+                    while ((count < RequiredChildren) && (index->Name != mandatoryProcesses[count])) {
+                        ++count;
+                    }
 
-                        //<! this is a mandatory process and if its still active reset its bit in requiredProcesses.
-                        //   If not we are not completely operational.
-                        if ((count < RequiredChildren) && (_children.Current().IsActive() == true)) {
-                            requiredProcesses &= (~(1 << count));
-                        }
+                    //<! this is a mandatory process, Validate() only kept the ones still active, so reset its bit in requiredProcesses.
+                    if (count < RequiredChildren) {
+                        requiredProcesses &= (~(1 << count));
                     }
                 }
+
+                _adminLock.Unlock();
             }
 
             return (((requiredProcesses == 0) || (true == IsStarting())) && (true == _main.IsActive()));
@@ -506,10 +484,110 @@ namespace WebKitBrowser {
             return (_startTime == TimePoint::min()) || (SteadyClock::now() < _startTime);
         }
 
+        // Sums the main process and its (cached) children. Only when a child disappeared between two
+        // polls the process table is walked again, otherwise this costs one statm read per process.
+        Usage Measure() const
+        {
+            Usage result = {};
+
+            if (_startTime != TimePoint::min()) {
+                _adminLock.Lock();
+
+                Refresh(false);
+
+                ReadStatm(_main.Id(), result);
+
+                Usage children = {};
+                if (Accumulate(children) == false) {
+                    Refresh(true);
+                    children = {};
+                    Accumulate(children);
+                }
+
+                result.Allocated += children.Allocated;
+                result.Resident += children.Resident;
+                result.Shared += children.Shared;
+
+                _adminLock.Unlock();
+            }
+
+            return (result);
+        }
+        bool Accumulate(Usage& usage) const
+        {
+            bool complete = true;
+
+            for (const Child& child : _children) {
+                complete = (ReadStatm(child.Id, usage) == true) && (complete == true);
+            }
+
+            return (complete);
+        }
+        // Drops the children that are gone, returns false if any was.
+        bool Validate() const
+        {
+            const size_t before = _children.size();
+
+            _children.erase(std::remove_if(_children.begin(), _children.end(),
+                [](const Child& child) { return (::kill(child.Id, 0) != 0); }), _children.end());
+
+            return (before == _children.size());
+        }
+        // Walking /proc is expensive on a loaded box, so only do it if the children changed, not all
+        // mandatory ones are (yet) known or once per RESCAN_INTERVAL to pick up newly spawned ones.
+        void Refresh(const bool force) const
+        {
+            const TimePoint now = SteadyClock::now();
+
+            if ((force == true) || (_children.size() < RequiredChildren) || (now >= _nextScan)) {
+                Core::ProcessInfo::Iterator iterator(_main.Id());
+
+                _children.clear();
+                _children.reserve(iterator.Count());
+
+                while (iterator.Next() == true) {
+                    _children.emplace_back(iterator.Current().Id(), iterator.Current().Name());
+                }
+
+                _nextScan = now + std::chrono::seconds(RESCAN_INTERVAL);
+            }
+        }
+        static bool ReadStatm(const pid_t pid, Usage& usage)
+        {
+            static const uint64_t pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+
+            bool result = false;
+            char path[32];
+            ::snprintf(path, sizeof(path), "/proc/%d/statm", static_cast<int>(pid));
+
+            int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                char buffer[128];
+                ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+                ::close(fd);
+
+                if (length > 0) {
+                    unsigned long long size = 0, resident = 0, shared = 0;
+                    buffer[length] = '\0';
+
+                    if (::sscanf(buffer, "%llu %llu %llu", &size, &resident, &shared) == 3) {
+                        usage.Allocated += (size * pageSize);
+                        usage.Resident += (resident * pageSize);
+                        usage.Shared += (shared * pageSize);
+                        result = true;
+                    }
+                }
+            }
+
+            return (result);
+        }
+
     private:
         Core::ProcessInfo _main;
-        mutable Core::ProcessInfo::Iterator _children;
+        mutable Children _children;
+        mutable TimePoint _nextScan;
         TimePoint _startTime; // !< Reference for monitor
+        mutable Core::CriticalSection _adminLock;
     };
 
     Exchange::IMemory* MemoryObserver(const RPC::IRemoteConnection* connection)
@@ -17,10 +17,14 @@
  * limitations under the License.
  */
 
+#include <deque>
+#include <iterator>
 #include <memory>
 #include <utility>
 #include <tuple>
+#include <unordered_map>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 
@@ -518,6 +522,7 @@ static GSourceFuncs _handlerIntervention =
                 , PageGroup(_T("WPEPageGroup"))
                 , CookieStorage()
                 , CloudCookieJarEnabled(false)
+                , CloudCookieJarDelta(false)
                 , LocalStorage()
                 , LocalStorageEnabled(false)
                 , LocalStorageSize()
@@ -566,6 +571,7 @@ static GSourceFuncs _handlerIntervention =
                 , LogToSystemConsoleEnabled(false)
                 , WatchDogCheckTimeoutInSeconds(0)
                 , WatchDogHangThresholdInSeconds(0)
+                , WatchDogIdleCheckTimeoutInSeconds(0)
                 , LoadBlankPageOnSuspendEnabled(false)
                 , UserScripts()
                 , AllowFileURLsCrossAccess()
@@ -575,6 +581,7 @@ static GSourceFuncs _handlerIntervention =
                 , ContentFilter()
                 , LoggingTarget()
                 , WebAudioEnabled(false)
+                , RawBridgeMessages(false)
             {
                 Add(_T("useragent"), &UserAgent);
                 Add(_T("url"), &URL);
@@ -582,6 +589,7 @@ static GSourceFuncs _handlerIntervention =
                 Add(_T("pagegroup"), &PageGroup);
                 Add(_T("cookiestorage"), &CookieStorage);
                 Add(_T("cloudcookiejarenabled"), &CloudCookieJarEnabled);
+                Add(_T("cloudcookiejardelta"), &CloudCookieJarDelta);
                 Add(_T("localstorage"), &LocalStorage);
                 Add(_T("localstorageenabled"), &LocalStorageEnabled);
                 Add(_T("localstoragesize"), &LocalStorageSize);
@@ -632,6 +640,7 @@ static GSourceFuncs _handlerIntervention =
                 Add(_T("logtosystemconsoleenabled"), &LogToSystemConsoleEnabled);
                 Add(_T("watchdogchecktimeoutinseconds"), &WatchDogCheckTimeoutInSeconds);
                 Add(_T("watchdoghangthresholdtinseconds"), &WatchDogHangThresholdInSeconds);
+                Add(_T("watchdogidlechecktimeoutinseconds"), &WatchDogIdleCheckTimeoutInSeconds);
                 Add(_T("loadblankpageonsuspendenabled"), &LoadBlankPageOnSuspendEnabled);
                 Add(_T("userscripts"), &UserScripts);
                 Add(_T("allowfileurlscrossaccess"), &AllowFileURLsCrossAccess);
@@ -641,6 +650,7 @@ static GSourceFuncs _handlerIntervention =
                 Add(_T("contentfilter"), &ContentFilter);
                 Add(_T("loggingtarget"), &LoggingTarget);
                 Add(_T("webaudio"), &WebAudioEnabled);
+                Add(_T("rawbridgemessages"), &RawBridgeMessages);
             }
             ~Config()
             {
@@ -653,6 +663,7 @@ static GSourceFuncs _handlerIntervention =
             Core::JSON::String PageGroup;
             Core::JSON::String CookieStorage;
             Core::JSON::Boolean CloudCookieJarEnabled;
+            Core::JSON::Boolean CloudCookieJarDelta; // Packed cookie jar only holds the changes since the previous one
             Core::JSON::String LocalStorage;
             Core::JSON::Boolean LocalStorageEnabled;
             Core::JSON::DecUInt16 LocalStorageSize;
@@ -703,6 +714,7 @@ static GSourceFuncs _handlerIntervention =
             Core::JSON::Boolean LogToSystemConsoleEnabled;
             Core::JSON::DecUInt16 WatchDogCheckTimeoutInSeconds;   // How often to check main event loop for responsiveness
             Core::JSON::DecUInt16 WatchDogHangThresholdInSeconds;  // The amount of time to give a process to recover before declaring a hang state
+            Core::JSON::DecUInt16 WatchDogIdleCheckTimeoutInSeconds; // Check interval while hidden or suspended, 0 to keep WatchDogCheckTimeoutInSeconds
             Core::JSON::Boolean LoadBlankPageOnSuspendEnabled;
             Core::JSON::ArrayType<Core::JSON::String> UserScripts;
             Core::JSON::Boolean AllowFileURLsCrossAccess;
@@ -712,43 +724,67 @@ static GSourceFuncs _handlerIntervention =
             Core::JSON::String ContentFilter;
             Core::JSON::String LoggingTarget;
             Core::JSON::Boolean WebAudioEnabled;
+            // Changes the $badger bridge contract: the payloads of BridgeReply / BridgeEvent are taken, and
+            // bridgequery events are sent, as plain UTF-8 text instead of base64. Only for clients that
+            // speak plain text; internally the payloads then travel as bytes ("ay") instead of strings.
+            Core::JSON::Boolean RawBridgeMessages;
         };
 
+        // Watchdog for the WebKit main loop and the web process. A timer on the main loop is the
+        // heartbeat, each beat probes the web process and the worker pool job declares a hang if
+        // no beat came within the threshold. While the page is hidden or suspended, and the web
+        // process is not suspect, beats back off to the idle interval; state and responsiveness
+        // changes re-arm the heartbeat right away.
         class HangDetector
         {
         private:
             WebKitImplementation& _browser;
             GSource* _timerSource { nullptr };
-            std::atomic_int _expiryCount { 0 };
 
-            int _watchDogTimeoutInSeconds { 0 };
-            int _watchDogTresholdInSeconds { 0 };
+            uint32_t _activeIntervalMs { 0 };
+            uint32_t _idleIntervalMs { 0 };
+            uint32_t _thresholdMs { 0 };
+            bool _suspect { false };
+            gint64 _dueAt { 0 };
+
+            // shared with the worker pool job
+            std::atomic<gint64> _lastBeat { 0 };
+            std::atomic<uint32_t> _intervalMs { 0 };
 
             friend Core::ThreadPool::JobType<HangDetector&>;
             Core::WorkerPool::JobType<HangDetector&> _worker;
 
-            void CheckResponsiveness()
+            void Beat()
             {
-                _expiryCount = 0;
+                const gint64 now = g_get_monotonic_time();
+
+                // a late beat is time the main loop could not run
+                const gint64 lateMs = (now - _dueAt) / 1000;
+                if (lateMs > 1000) {
+                    SYSLOG(Logging::Notification, (_T("WebKit main loop stalled, watchdog heartbeat %" G_GINT64_FORMAT " ms late\n"), lateMs));
+                }
+
+                _lastBeat = now;
                 _browser.CheckWebProcess();
+                Rearm();
             }
 
             void Dispatch()
             {
-                ++_expiryCount;
+                const uint32_t intervalMs = _intervalMs;
+                const gint64 silentMs = (g_get_monotonic_time() - _lastBeat) / 1000;
 
-                if ( _expiryCount > (_watchDogTresholdInSeconds /  _watchDogTimeoutInSeconds) ) {
+                // the next beat is only due an interval after the last one
+                if (silentMs > static_cast<gint64>(_thresholdMs + intervalMs)) {
                     _browser.DeactivateBrowser(PluginHost::IShell::WATCHDOG_EXPIRED);
                 }
 
-                _worker.Reschedule(Core::Time::Now().Add(_watchDogTimeoutInSeconds * 1000));
+                _worker.Reschedule(Core::Time::Now().Add(intervalMs));
             }
 
         public:
             ~HangDetector()
             {
-                _expiryCount = 0;
-
                 if (_timerSource) {
                     g_source_destroy (_timerSource);
                     g_source_unref (_timerSource);
@@ -759,49 +795,412 @@ static GSourceFuncs _handlerIntervention =
                 : _browser(browser)
                 , _worker(*this)
             {
-                _watchDogTimeoutInSeconds = _browser._config.WatchDogCheckTimeoutInSeconds.Value();
-                _watchDogTresholdInSeconds  = _browser._config.WatchDogHangThresholdInSeconds.Value();
+                _activeIntervalMs = _browser._config.WatchDogCheckTimeoutInSeconds.Value() * 1000;
+                _thresholdMs = _browser._config.WatchDogHangThresholdInSeconds.Value() * 1000;
+                _idleIntervalMs = std::max<uint32_t>(_browser._config.WatchDogIdleCheckTimeoutInSeconds.Value() * 1000, _activeIntervalMs);
 
-                if (_watchDogTimeoutInSeconds == 0 || _watchDogTresholdInSeconds == 0)
+                if (_activeIntervalMs == 0 || _thresholdMs == 0)
                     return;
 
-                GMainContext* ctx = _browser._context;
-                _timerSource = g_timeout_source_new_seconds ( _watchDogTimeoutInSeconds );
+                _lastBeat = g_get_monotonic_time();
+                Rearm();
 
-                g_source_set_callback (
-                    _timerSource,
-                    [](gpointer data) -> gboolean
-                    {
-                        static_cast<HangDetector*>(data)->CheckResponsiveness();
-                        return G_SOURCE_CONTINUE;
-                    },
-                    this,
-                    nullptr
-                    );
-                g_source_attach ( _timerSource, ctx );
+                _worker.Reschedule(Core::Time::Now().Add(_intervalMs));
+            }
+
+            // (Re)starts the heartbeat at the rate the page state asks for. Main loop only.
+            void Rearm()
+            {
+                if (_activeIntervalMs == 0 || _thresholdMs == 0)
+                    return;
+
+                if (_timerSource) {
+                    g_source_destroy (_timerSource);
+                    g_source_unref (_timerSource);
+                }
+
+                _browser._adminLock.Lock();
+                const bool idle = (_browser._state == PluginHost::IStateControl::SUSPENDED) || (_browser._hidden == true);
+                _browser._adminLock.Unlock();
+
+                const uint32_t intervalMs = (idle && !_suspect && (_browser._unresponsiveReplyNum == 0)) ? _idleIntervalMs : _activeIntervalMs;
+                _intervalMs = intervalMs;
+                _dueAt = g_get_monotonic_time() + (static_cast<gint64>(intervalMs) * 1000);
 
-                #if 0
-                auto hangSource = g_timeout_source_new_seconds ( 5 );
+                _timerSource = g_timeout_source_new (intervalMs);
                 g_source_set_callback (
-                    hangSource,
+                    _timerSource,
                     [](gpointer data) -> gboolean
                     {
-                        g_usleep( G_MAXULONG );
+                        static_cast<HangDetector*>(data)->Beat();
                         return G_SOURCE_REMOVE;
                     },
                     this,
                     nullptr
                     );
-                g_source_attach ( hangSource, ctx );
-                #endif
+                g_source_attach ( _timerSource, _browser._context );
+            }
+
+            // WebKit's own responsiveness notification, an unresponsive web process is probed at once.
+            void ResponsivenessChanged(const bool responsive)
+            {
+                if (_activeIntervalMs == 0 || _thresholdMs == 0)
+                    return;
 
-                _worker.Reschedule(Core::Time::Now().Add(_watchDogTimeoutInSeconds * 1000));
+                _suspect = !responsive;
+                if (_suspect) {
+                    _browser.CheckWebProcess();
+                }
+                Rearm();
             }
 
             HangDetector(const HangDetector&) = delete;
             HangDetector& operator=(const HangDetector&) = delete;
         };
 
+        // Delivers the notifications of one registered sink from a thread of its own, in the
+        // order they were raised. Every sink call can be a COM-RPC round trip, this way a slow
+        // client holds up neither the WebKit thread nor the other clients. A client that stops
+        // taking notifications loses the ones beyond MaxPending instead of growing its queue.
+        struct NotifierEvent {
+            string Text;
+            int32_t Value;
+        };
+
+        template <typename INTERFACE>
+        class Notifier : public Core::Thread
+        {
+        public:
+            static constexpr uint16_t MaxPending = 256;
+
+            using Handler = void (*)(INTERFACE*, const NotifierEvent&);
+
+        private:
+            struct Entry {
+                Handler Execute;
+                NotifierEvent Event;
+            };
+
+        public:
+            Notifier(const Notifier&) = delete;
+            Notifier& operator=(const Notifier&) = delete;
+
+            Notifier(INTERFACE* sink)
+                : Core::Thread(0, _T("WebKitNotifier"))
+                , _sink(sink)
+                , _lock()
+                , _dispatchLock()
+                , _events()
+                , _closed(false)
+                , _dropped(0)
+            {
+            }
+            ~Notifier() override
+            {
+                Block();
+                Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+            }
+
+        public:
+            void Submit(Handler handler, const string& text, const int32_t value)
+            {
+                bool queued = false;
+
+                _lock.Lock();
+                if (_closed == false) {
+                    if (_events.size() < MaxPending) {
+                        _events.push_back({ handler, { text, value } });
+                        queued = true;
+                    } else if (_dropped++ == 0) {
+                        SYSLOG(Logging::Notification, (_T("Notification sink %p is not keeping up, dropping notifications"), _sink));
+                    }
+                }
+                _lock.Unlock();
+
+                if (queued == true) {
+                    Run();
+                }
+            }
+            // Stops the deliveries and returns once the sink is not being called any more, it
+            // can be released safely afterwards. A sink that unregisters from within its own
+            // notification is on this thread, the only call in progress is its own then and
+            // there is nothing to wait for.
+            void Close()
+            {
+                _lock.Lock();
+                _closed = true;
+                _events.clear();
+                _lock.Unlock();
+
+                if (Core::Thread::ThreadId() != Id()) {
+                    _dispatchLock.Lock();
+                    _dispatchLock.Unlock();
+                }
+            }
+
+        private:
+            uint32_t Worker() override
+            {
+                uint32_t result = 0;
+
+                _dispatchLock.Lock();
+                _lock.Lock();
+
+                if ((_closed == true) || (_events.empty() == true)) {
+                    if (_dropped != 0) {
+                        SYSLOG(Logging::Notification, (_T("Notification sink %p dropped %u notifications"), _sink, _dropped));
+                        _dropped = 0;
+                    }
+                    Block();
+                    _lock.Unlock();
+                    result = Core::infinite;
+                } else {
+                    Entry entry(std::move(_events.front()));
+                    _events.pop_front();
+
+                    _lock.Unlock();
+
+                    entry.Execute(_sink, entry.Event);
+                }
+
+                _dispatchLock.Unlock();
+
+                return (result);
+            }
+
+        private:
+            INTERFACE* _sink;
+            Core::CriticalSection _lock;
+            Core::CriticalSection _dispatchLock;
+            std::deque<Entry> _events;
+            bool _closed;
+            uint32_t _dropped;
+        };
+
+        // Copy-on-write list of notification sinks, each with its own Notifier. Changes replace
+        // the whole list, so a fan-out only needs the lock to grab the current snapshot and can
+        // queue to the sinks without it. The owner serializes changes with its _adminLock.
+        template <typename INTERFACE>
+        class SubscriberList
+        {
+        public:
+            struct Subscriber {
+                INTERFACE* Sink;
+                std::shared_ptr<Notifier<INTERFACE>> Lane;
+            };
+
+            using Snapshot = std::shared_ptr<const std::vector<Subscriber>>;
+
+        public:
+            SubscriberList(const SubscriberList&) = delete;
+            SubscriberList& operator=(const SubscriberList&) = delete;
+
+            SubscriberList()
+                : _list(std::make_shared<const std::vector<Subscriber>>())
+            {
+            }
+            ~SubscriberList() = default;
+
+        public:
+            bool Contains(const INTERFACE* sink) const
+            {
+                return (std::find_if(_list->begin(), _list->end(),
+                    [sink](const Subscriber& entry) { return (entry.Sink == sink); }) != _list->end());
+            }
+            void Add(INTERFACE* sink)
+            {
+                auto list = std::make_shared<std::vector<Subscriber>>(*_list);
+                list->push_back({ sink, std::make_shared<Notifier<INTERFACE>>(sink) });
+                _list = std::move(list);
+            }
+            // Returns the Notifier of the removed sink, nullptr if it was not in the list.
+            std::shared_ptr<Notifier<INTERFACE>> Remove(const INTERFACE* sink)
+            {
+                std::shared_ptr<Notifier<INTERFACE>> lane;
+
+                if (Contains(sink) == true) {
+                    auto list = std::make_shared<std::vector<Subscriber>>();
+                    list->reserve(_list->size() - 1);
+                    for (const Subscriber& entry : *_list) {
+                        if (entry.Sink != sink) {
+                            list->push_back(entry);
+                        } else {
+                            lane = entry.Lane;
+                        }
+                    }
+                    _list = std::move(list);
+                }
+
+                return (lane);
+            }
+            const Snapshot& Current() const
+            {
+                return (_list);
+            }
+
+        private:
+            Snapshot _list;
+        };
+
+        // Commands posted from other threads to the WebKit thread. All commands end up in
+        // a single GSource that is woken once per burst and drains them in posting order.
+        // Command slots (and the capacity of their strings) are reused between bursts.
+        // State transitions (show, hide, suspend, resume) go through it as well, so every
+        // command runs in the order it was posted relative to them. Posts after Close()
+        // are dropped.
+        class CommandQueue
+        {
+        public:
+            struct Command {
+                using Handler = void (*)(WebKitImplementation&, const Command&);
+
+                Handler Execute;
+                string Payload;
+                uint32_t Value;
+                string Name;
+            };
+
+        private:
+            struct Source {
+                GSource Base;
+                CommandQueue* Queue;
+            };
+
+            // Strings grown beyond this size (big bridge messages, scripts) are released
+            // after execution instead of being kept around for the next burst.
+            static constexpr size_t MaxRetainedCapacity = 4096;
+
+            static gboolean Dispatch(GSource* source, GSourceFunc, gpointer)
+            {
+                g_source_set_ready_time(source, -1);
+                reinterpret_cast<Source*>(source)->Queue->Drain();
+                return G_SOURCE_CONTINUE;
+            }
+
+            void Drain()
+            {
+                _lock.Lock();
+                std::swap(_pending, _draining);
+                const size_t count = _pendingCount;
+                _pendingCount = 0;
+                _lock.Unlock();
+
+                for (size_t index = 0; index < count; ++index) {
+                    Command& command = _draining[index];
+                    command.Execute(_browser, command);
+
+                    if (command.Payload.capacity() > MaxRetainedCapacity) {
+                        string().swap(command.Payload);
+                    }
+                    if (command.Name.capacity() > MaxRetainedCapacity) {
+                        string().swap(command.Name);
+                    }
+                }
+            }
+
+        public:
+            CommandQueue(const CommandQueue&) = delete;
+            CommandQueue& operator=(const CommandQueue&) = delete;
+
+            CommandQueue(WebKitImplementation& browser)
+                : _browser(browser)
+                , _lock()
+                , _source(nullptr)
+                , _pending()
+                , _draining()
+                , _pendingCount(0)
+                , _closed(false)
+            {
+            }
+            ~CommandQueue()
+            {
+                ASSERT(_source == nullptr);
+            }
+
+        public:
+            void Open(GMainContext* context)
+            {
+                static GSourceFuncs sourceFuncs = {
+                    nullptr, // prepare
+                    nullptr, // check
+                    Dispatch,
+                    nullptr, // finalize
+                };
+
+                ASSERT(_source == nullptr);
+
+                GSource* source = g_source_new(&sourceFuncs, sizeof(Source));
+                reinterpret_cast<Source*>(source)->Queue = this;
+                g_source_set_name(source, "WebKitBrowserCommands");
+                g_source_set_priority(source, G_PRIORITY_DEFAULT);
+                g_source_attach(source, context);
+
+                _lock.Lock();
+                _source = source;
+                _closed = false;
+                if (_pendingCount != 0) {
+                    g_source_set_ready_time(_source, 0);
+                }
+                _lock.Unlock();
+            }
+            void Close()
+            {
+                _lock.Lock();
+                GSource* source = _source;
+                _source = nullptr;
+                _pendingCount = 0;
+                _closed = true;
+                _lock.Unlock();
+
+                if (source != nullptr) {
+                    g_source_destroy(source);
+                    g_source_unref(source);
+                }
+            }
+            void Post(Command::Handler handler, const string& payload = string(), const uint32_t value = 0, const string& name = string())
+            {
+                _lock.Lock();
+
+                if (_closed == true) {
+                    // The WebKit thread is gone, nothing would ever run it.
+                    _lock.Unlock();
+                } else if ((_pendingCount == 0) && (_source != nullptr) && (g_main_context_is_owner(g_source_get_context(_source)) == TRUE)) {
+                    // Posted from the WebKit thread itself and nothing is waiting: run it in place,
+                    // just like g_main_context_invoke() would have done.
+                    _lock.Unlock();
+
+                    Command command { handler, payload, value, name };
+                    handler(_browser, command);
+                } else {
+                    if (_pendingCount == _pending.size()) {
+                        _pending.emplace_back();
+                    }
+
+                    Command& command = _pending[_pendingCount++];
+                    command.Execute = handler;
+                    command.Payload.assign(payload);
+                    command.Value = value;
+                    command.Name.assign(name);
+
+                    // Only the first command of a burst needs to wake up the main loop.
+                    if ((_pendingCount == 1) && (_source != nullptr)) {
+                        g_source_set_ready_time(_source, 0);
+                    }
+
+                    _lock.Unlock();
+                }
+            }
+
+        private:
+            WebKitImplementation& _browser;
+            Core::CriticalSection _lock;
+            GSource* _source;
+            std::vector<Command> _pending;
+            std::vector<Command> _draining;
+            size_t _pendingCount;
+            bool _closed;
+        };
+
     private:
         WebKitImplementation(const WebKitImplementation&) = delete;
         WebKitImplementation& operator=(const WebKitImplementation&) = delete;
@@ -840,6 +1239,8 @@ static GSourceFuncs _handlerIntervention =
             , _notificationBrowserClients()
             , _stateControlClients()
             , _applicationClients()
+            , _retiredLanes()
+            , _commands(*this)
             , _state(PluginHost::IStateControl::UNINITIALIZED)
             , _hidden(false)
             , _time(0)
@@ -847,6 +1248,7 @@ static GSourceFuncs _handlerIntervention =
             , _configurationCompleted(false)
             , _webProcessCheckInProgress(false)
             , _unresponsiveReplyNum(0)
+            , _hangDetector(nullptr)
             , _frameCount(0)
             , _lastDumpTime(g_get_monotonic_time())
         {
@@ -894,39 +1296,28 @@ static GSourceFuncs _handlerIntervention =
         uint32_t HeaderList(const string& headerlist) override
         {
             if (_context != nullptr) {
-                using SetHeadersData = std::tuple<WebKitImplementation*, string>;
-                auto* data = new SetHeadersData(this, headerlist);
-
-                g_main_context_invoke_full(
-                    _context,
-                    G_PRIORITY_DEFAULT,
-                    [](gpointer customdata) -> gboolean {
-                        auto& data = *static_cast<SetHeadersData*>(customdata);
-                        WebKitImplementation* object = std::get<0>(data);
-                        const string& headers = std::get<1>(data);
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                        const string& headers = command.Payload;
 
-                        object->_adminLock.Lock();
-                        object->_headers = headers;
-                        object->_adminLock.Unlock();
+                        object._adminLock.Lock();
+                        object._headers = headers;
+                        object._adminLock.Unlock();
 #ifdef WEBKIT_GLIB_API
-                        webkit_web_view_send_message_to_page(object->_view,
+                        webkit_web_view_send_message_to_page(object._view,
                                 webkit_user_message_new(Tags::Headers, g_variant_new("s", headers.c_str())),
                                 nullptr, nullptr, nullptr);
 #else
                         auto messageName = WKStringCreateWithUTF8CString(Tags::Headers);
                         auto messageBody = WKStringCreateWithUTF8CString(headers.c_str());
 
-                        WKPagePostMessageToInjectedBundle(object->_page, messageName, messageBody);
+                        WKPagePostMessageToInjectedBundle(object._page, messageName, messageBody);
 
                         WKRelease(messageBody);
                         WKRelease(messageName);
 #endif
-                        return G_SOURCE_REMOVE;
                     },
-                    data,
-                    [](gpointer customdata) {
-                        delete static_cast<SetHeadersData*>(customdata);
-                    });
+                    headerlist);
             }
 
             return Core::ERROR_NONE;
@@ -946,36 +1337,25 @@ static GSourceFuncs _handlerIntervention =
             if (_context == nullptr)
                 return Core::ERROR_GENERAL;
 
-            using SetUserAgentData = std::tuple<WebKitImplementation*, string>;
-            auto* data = new SetUserAgentData(this, useragent);
-
             TRACE(Trace::Information, (_T("New user agent: %s"), useragent.c_str()));
 
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<SetUserAgentData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-                    const string& useragent = std::get<1>(data);
-
-                    object->_adminLock.Lock();
-                    object->_config.UserAgent = useragent;
-                    object->_adminLock.Unlock();
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                    const string& useragent = command.Payload;
+
+                    object._adminLock.Lock();
+                    object._config.UserAgent = useragent;
+                    object._adminLock.Unlock();
 #ifdef WEBKIT_GLIB_API
-                    WebKitSettings* settings = webkit_web_view_get_settings(object->_view);
+                    WebKitSettings* settings = webkit_web_view_get_settings(object._view);
                     webkit_settings_set_user_agent(settings, useragent.c_str());
 #else
                     auto ua = WKStringCreateWithUTF8CString(useragent.c_str());
-                    WKPageSetCustomUserAgent(object->_page, ua);
+                    WKPageSetCustomUserAgent(object._page, ua);
                     WKRelease(ua);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<SetUserAgentData*>(customdata);
-                });
+                useragent);
 
             return Core::ERROR_NONE;
         }
@@ -994,34 +1374,24 @@ static GSourceFuncs _handlerIntervention =
             if (_context == nullptr)
                 return Core::ERROR_GENERAL;
 
-            using SetLocalStorageEnabledData = std::tuple<WebKitImplementation*, bool>;
-            auto* data = new SetLocalStorageEnabledData(this, enabled);
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<SetLocalStorageEnabledData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-                    bool enabled = std::get<1>(data);
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                    bool enabled = (command.Value != 0);
 
-                    object->_adminLock.Lock();
-                    object->_localStorageEnabled = enabled;
-                    object->_adminLock.Unlock();
+                    object._adminLock.Lock();
+                    object._localStorageEnabled = enabled;
+                    object._adminLock.Unlock();
 
 #ifdef WEBKIT_GLIB_API
-                    WebKitSettings* settings = webkit_web_view_get_settings(object->_view);
+                    WebKitSettings* settings = webkit_web_view_get_settings(object._view);
                     webkit_settings_set_enable_html5_local_storage(settings, enabled);
 #else
-                    auto group = WKPageGetPageGroup(object->_page);
+                    auto group = WKPageGetPageGroup(object._page);
                     auto preferences = WKPageGroupGetPreferences(group);
                     WKPreferencesSetLocalStorageEnabled(preferences, enabled);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<SetLocalStorageEnabledData*>(customdata);
-                });
+                string(), (enabled ? 1 : 0));
 
             return Core::ERROR_NONE;
         }
@@ -1085,7 +1455,6 @@ static GSourceFuncs _handlerIntervention =
                     ASSERT(false);
                     return WEBKIT_COOKIE_POLICY_ACCEPT_NO_THIRD_PARTY;
                 };
-            using SetHTTPCookieAcceptPolicyData = std::tuple<WebKitImplementation*, WebKitCookieAcceptPolicy>;
 #else
             auto translatePolicy =
                 [](Exchange::IWebBrowser::HTTPCookieAcceptPolicyType policy) {
@@ -1102,43 +1471,32 @@ static GSourceFuncs _handlerIntervention =
                     ASSERT(false);
                     return kWKHTTPCookieAcceptPolicyOnlyFromMainDocumentDomain;
                 };
-            using SetHTTPCookieAcceptPolicyData = std::tuple<WebKitImplementation*, WKHTTPCookieAcceptPolicy>;
 #endif
-            auto* data = new SetHTTPCookieAcceptPolicyData(this, translatePolicy(policy));
-
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<SetHTTPCookieAcceptPolicyData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
 #ifdef WEBKIT_GLIB_API
-                    WebKitCookieAcceptPolicy policy =  std::get<1>(data);
+                    WebKitCookieAcceptPolicy policy = static_cast<WebKitCookieAcceptPolicy>(command.Value);
 
-                    object->_adminLock.Lock();
-                    object->_httpCookieAcceptPolicy = policy;
-                    object->_adminLock.Unlock();
+                    object._adminLock.Lock();
+                    object._httpCookieAcceptPolicy = policy;
+                    object._adminLock.Unlock();
 
-                    WebKitWebContext* context = webkit_web_view_get_context(object->_view);
+                    WebKitWebContext* context = webkit_web_view_get_context(object._view);
                     WebKitCookieManager* manager = webkit_web_context_get_cookie_manager(context);
                     webkit_cookie_manager_set_accept_policy(manager, policy);
 #else
-                    WKHTTPCookieAcceptPolicy policy =  std::get<1>(data);
+                    WKHTTPCookieAcceptPolicy policy = static_cast<WKHTTPCookieAcceptPolicy>(command.Value);
 
-                    object->_adminLock.Lock();
-                    object->_httpCookieAcceptPolicy = policy;
-                    object->_adminLock.Unlock();
+                    object._adminLock.Lock();
+                    object._httpCookieAcceptPolicy = policy;
+                    object._adminLock.Unlock();
 
-                    auto context = WKPageGetContext(object->_page);
+                    auto context = WKPageGetContext(object._page);
                     auto manager = WKContextGetCookieManager(context);
                     WKCookieManagerSetHTTPCookieAcceptPolicy(manager, policy);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<SetHTTPCookieAcceptPolicyData*>(customdata);
-                });
+                string(), static_cast<uint32_t>(translatePolicy(policy)));
 
             return Core::ERROR_NONE;
         }
@@ -1160,59 +1518,46 @@ static GSourceFuncs _handlerIntervention =
             if (_context == nullptr)
                 return;
 
-            using BridgeMessageData = std::tuple<WebKitImplementation*, string, string>;
-            auto* data = new BridgeMessageData(this, name, payload);
-
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    BridgeMessageData& data = *static_cast<BridgeMessageData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
 #ifdef WEBKIT_GLIB_API
-                    auto messageName = std::get<1>(data).c_str();
-                    auto messageBody = std::get<2>(data).c_str();
-
-                    webkit_web_view_send_message_to_page(object->_view,
-                            webkit_user_message_new(messageName, g_variant_new("s", messageBody)),
+                    GVariant* body;
+                    if (object._config.RawBridgeMessages.Value() == true) {
+                        body = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, command.Payload.data(), command.Payload.size(), sizeof(gchar));
+                    } else {
+                        body = g_variant_new("s", command.Payload.c_str());
+                    }
+                    webkit_web_view_send_message_to_page(object._view,
+                            webkit_user_message_new(command.Name.c_str(), body),
                             nullptr, nullptr, nullptr);
 #else
-                    auto messageName = WKStringCreateWithUTF8CString(std::get<1>(data).c_str());
-                    auto messageBody = WKStringCreateWithUTF8CString(std::get<2>(data).c_str());
+                    auto messageName = WKStringCreateWithUTF8CString(command.Name.c_str());
+                    auto messageBody = WKStringCreateWithUTF8CString(command.Payload.c_str());
 
-                    WKPagePostMessageToInjectedBundle(object->_page, messageName, messageBody);
+                    WKPagePostMessageToInjectedBundle(object._page, messageName, messageBody);
 
                     WKRelease(messageBody);
                     WKRelease(messageName);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<BridgeMessageData*>(customdata);
-                });
+                payload, 0, name);
         }
 
         uint32_t CollectGarbage() override
         {
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+            if (_context == nullptr)
+                return Core::ERROR_GENERAL;
+
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command&) {
 #ifdef WEBKIT_GLIB_API
-                WebKitWebContext* context = webkit_web_view_get_context(object->_view);
-                webkit_web_context_garbage_collect_javascript_objects(context);
+                    WebKitWebContext* context = webkit_web_view_get_context(object._view);
+                    webkit_web_context_garbage_collect_javascript_objects(context);
 #else
-                auto context = WKPageGetContext(object->_page);
-                WKContextGarbageCollectJavaScriptObjects(context);
+                    auto context = WKPageGetContext(object._page);
+                    WKContextGarbageCollectJavaScriptObjects(context);
 #endif
-                return G_SOURCE_REMOVE;
-            },
-            this,
-            [](gpointer) {
-            });
+                });
             return Core::ERROR_NONE;
         }
 
@@ -1221,29 +1566,18 @@ static GSourceFuncs _handlerIntervention =
             if (_context == nullptr)
                 return Core::ERROR_GENERAL;
 
-            using RunJavaScriptData = std::tuple<WebKitImplementation*, string>;
-            auto* data = new RunJavaScriptData(this, script);
-
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<RunJavaScriptData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-                    auto& script = std::get<1>(data);
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                    const string& script = command.Payload;
 #ifdef WEBKIT_GLIB_API
-                    webkit_web_view_run_javascript(object->_view, script.c_str(), nullptr, nullptr, nullptr);
+                    webkit_web_view_run_javascript(object._view, script.c_str(), nullptr, nullptr, nullptr);
 #else
                     auto scriptRef = WKStringCreateWithUTF8CString(script.c_str());
-                    WKPageRunJavaScriptInMainFrame(object->_page, scriptRef, nullptr, [](WKSerializedScriptValueRef, WKErrorRef, void*){});
+                    WKPageRunJavaScriptInMainFrame(object._page, scriptRef, nullptr, [](WKSerializedScriptValueRef, WKErrorRef, void*){});
                     WKRelease(scriptRef);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<RunJavaScriptData*>(customdata);
-                });
+                script);
             return Core::ERROR_NONE;
         }
 
@@ -1251,23 +1585,12 @@ static GSourceFuncs _handlerIntervention =
         {
             if (_context == nullptr)
                 return Core::ERROR_GENERAL;
-            using AddUserScriptData = std::tuple<WebKitImplementation*, string, bool>;
-            auto* data = new AddUserScriptData(this, script, topFrameOnly);
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<AddUserScriptData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-                    const auto& scriptContent = std::get<1>(data);
-                    const bool topFrameOnly = std::get<2>(data);
-                    object->AddUserScriptImpl(scriptContent.c_str(), topFrameOnly);
-                    return G_SOURCE_REMOVE;
+
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                    object.AddUserScriptImpl(command.Payload.c_str(), (command.Value != 0));
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<AddUserScriptData*>(customdata);
-                });
+                script, (topFrameOnly ? 1 : 0));
             return Core::ERROR_NONE;
         }
 
@@ -1276,21 +1599,15 @@ static GSourceFuncs _handlerIntervention =
             if (_context == nullptr)
                 return Core::ERROR_GENERAL;
 
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command&) {
 #ifdef WEBKIT_GLIB_API
-                    auto* userContentManager = webkit_web_view_get_user_content_manager(object->_view);
+                    auto* userContentManager = webkit_web_view_get_user_content_manager(object._view);
                     webkit_user_content_manager_remove_all_scripts(userContentManager);
 #else
-                    WKUserContentControllerRemoveAllUserScripts(object->_userContentController);
+                    WKUserContentControllerRemoveAllUserScripts(object._userContentController);
 #endif
-                    return G_SOURCE_REMOVE;
-                },
-                this,
-                nullptr);
+                });
             return Core::ERROR_NONE;
         }
 
@@ -1363,11 +1680,14 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Lock();
 
             // Make sure a sink is not registered multiple times.
-            ASSERT(std::find(_cookieJarClients.begin(), _cookieJarClients.end(), sink) == _cookieJarClients.end());
+            ASSERT(_cookieJarClients.Contains(sink) == false);
 
-            _cookieJarClients.push_back(sink);
+            _cookieJarClients.Add(sink);
             sink->AddRef();
 
+            // A new client has none of the earlier deltas
+            _cookieJar.RequestSnapshot();
+
             TRACE(Trace::Information, (_T("Registered cookie jar notification client %p"), sink));
 
             _adminLock.Unlock();
@@ -1377,33 +1697,31 @@ static GSourceFuncs _handlerIntervention =
         {
             _adminLock.Lock();
 
-            auto index(std::find(_cookieJarClients.begin(), _cookieJarClients.end(), sink));
+            auto lane = _cookieJarClients.Remove(sink);
+
+            _adminLock.Unlock();
 
             // Make sure you do not unregister something you did not register !!!
-            ASSERT(index != _cookieJarClients.end());
+            ASSERT(lane != nullptr);
 
-            if (index != _cookieJarClients.end()) {
-                (*index)->Release();
-                _cookieJarClients.erase(index);
+            if (lane != nullptr) {
+                // A notification might be on its way to this sink right now.
+                lane->Close();
+                Retire(std::move(lane));
+                sink->Release();
                 TRACE(Trace::Information, (_T("Unregistered cookie jar notification client %p"), sink));
             }
-
-            _adminLock.Unlock();
         }
 
         void NotifyCookieJarChanged()
         {
             _adminLock.Lock();
-
             _cookieJar.MarkAsStale();
-
-            auto index(_cookieJarClients.begin());
-            while (index != _cookieJarClients.end()) {
-                (*index)->CookieJarChanged();
-                index++;
-            }
-
             _adminLock.Unlock();
+
+            Notify(_cookieJarClients, [](Exchange::IBrowserCookieJar::INotification* client, const NotifierEvent&) {
+                client->CookieJarChanged();
+            });
         }
 
         void RefreshCookieJar()
@@ -1613,35 +1931,11 @@ static GSourceFuncs _handlerIntervention =
             TRACE(Trace::Information, (_T("New URL: %s"), URL.c_str()));
 
             if (_context != nullptr) {
-                using SetURLData = std::tuple<WebKitImplementation*, string>;
-                auto *data = new SetURLData(this, URL);
-                g_main_context_invoke_full(
-                    _context,
-                    G_PRIORITY_DEFAULT,
-                    [](gpointer customdata) -> gboolean {
-                        auto& data = *static_cast<SetURLData*>(customdata);
-                        WebKitImplementation* object = std::get<0>(data);
-
-                        string url = std::get<1>(data);
-                        object->_adminLock.Lock();
-                        object->_URL = url;
-                        object->_adminLock.Unlock();
-
-                        object->SetResponseHTTPStatusCode(-1);
-#ifdef WEBKIT_GLIB_API
-                        webkit_web_view_load_uri(object->_view, object->_URL.c_str());
-#else
-                        object->SetNavigationRef(nullptr);
-                        auto shellURL = WKURLCreateWithUTF8CString(object->_URL.c_str());
-                        WKPageLoadURL(object->_page, shellURL);
-                        WKRelease(shellURL);
-#endif
-                        return G_SOURCE_REMOVE;
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                        object.LoadURL(command.Payload);
                     },
-                    data,
-                    [](gpointer customdata) {
-                        delete static_cast<SetURLData*>(customdata);
-                    });
+                    URL);
             }
 
             return Core::ERROR_NONE;
@@ -1707,9 +2001,9 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Lock();
 
             // Make sure a sink is not registered multiple times.
-            ASSERT(std::find(_stateControlClients.begin(), _stateControlClients.end(), sink) == _stateControlClients.end());
+            ASSERT(_stateControlClients.Contains(sink) == false);
 
-            _stateControlClients.push_back(sink);
+            _stateControlClients.Add(sink);
             sink->AddRef();
 
             _adminLock.Unlock();
@@ -1721,18 +2015,20 @@ static GSourceFuncs _handlerIntervention =
         {
             _adminLock.Lock();
 
-            std::list<PluginHost::IStateControl::INotification*>::iterator index(std::find(_stateControlClients.begin(), _stateControlClients.end(), sink));
+            auto lane = _stateControlClients.Remove(sink);
+
+            _adminLock.Unlock();
 
             // Make sure you do not unregister something you did not register !!!
-            ASSERT(index != _stateControlClients.end());
+            ASSERT(lane != nullptr);
 
-            if (index != _stateControlClients.end()) {
-                (*index)->Release();
-                _stateControlClients.erase(index);
+            if (lane != nullptr) {
+                // A notification might be on its way to this sink right now.
+                lane->Close();
+                Retire(std::move(lane));
+                sink->Release();
                 TRACE(Trace::Information, (_T("Unregistered a sink on the browser %p"), sink));
             }
-
-            _adminLock.Unlock();
         }
 
         void Hide(const bool hidden) override
@@ -1768,9 +2064,9 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Lock();
 
             // Make sure a sink is not registered multiple times.
-            ASSERT(std::find(_notificationClients.begin(), _notificationClients.end(), sink) == _notificationClients.end());
+            ASSERT(_notificationClients.Contains(sink) == false);
 
-            _notificationClients.push_back(sink);
+            _notificationClients.Add(sink);
             sink->AddRef();
 
             _adminLock.Unlock();
@@ -1782,18 +2078,20 @@ static GSourceFuncs _handlerIntervention =
         {
             _adminLock.Lock();
 
-            std::list<Exchange::IWebBrowser::INotification*>::iterator index(std::find(_notificationClients.begin(), _notificationClients.end(), sink));
+            auto lane = _notificationClients.Remove(sink);
+
+            _adminLock.Unlock();
 
             // Make sure you do not unregister something you did not register !!!
-            ASSERT(index != _notificationClients.end());
+            ASSERT(lane != nullptr);
 
-            if (index != _notificationClients.end()) {
-                (*index)->Release();
-                _notificationClients.erase(index);
+            if (lane != nullptr) {
+                // A notification might be on its way to this sink right now.
+                lane->Close();
+                Retire(std::move(lane));
+                sink->Release();
                 TRACE(Trace::Information, (_T("Unregistered a sink on the browser %p"), sink));
             }
-
-            _adminLock.Unlock();
         }
 
         void Register(Exchange::IBrowser::INotification* sink) override
@@ -1801,9 +2099,9 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Lock();
 
             // Make sure a sink is not registered multiple times.
-            ASSERT(std::find(_notificationBrowserClients.begin(), _notificationBrowserClients.end(), sink) == _notificationBrowserClients.end());
+            ASSERT(_notificationBrowserClients.Contains(sink) == false);
 
-            _notificationBrowserClients.push_back(sink);
+            _notificationBrowserClients.Add(sink);
             sink->AddRef();
 
             _adminLock.Unlock();
@@ -1815,18 +2113,20 @@ static GSourceFuncs _handlerIntervention =
         {
             _adminLock.Lock();
 
-            auto index(std::find(_notificationBrowserClients.begin(), _notificationBrowserClients.end(), sink));
+            auto lane = _notificationBrowserClients.Remove(sink);
+
+            _adminLock.Unlock();
 
             // Make sure you do not unregister something you did not register !!!
-            ASSERT(index != _notificationBrowserClients.end());
+            ASSERT(lane != nullptr);
 
-            if (index != _notificationBrowserClients.end()) {
-                (*index)->Release();
-                _notificationBrowserClients.erase(index);
+            if (lane != nullptr) {
+                // A notification might be on its way to this sink right now.
+                lane->Close();
+                Retire(std::move(lane));
+                sink->Release();
                 TRACE(Trace::Information, (_T("Unregistered a sink on the browser %p"), sink));
             }
-
-            _adminLock.Unlock();
         }
 
         // IApplication implementation
@@ -1836,9 +2136,9 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Lock();
 
             // Make sure a sink is not registered multiple times.
-            ASSERT(std::find(_applicationClients.begin(), _applicationClients.end(), sink) == _applicationClients.end());
+            ASSERT(_applicationClients.Contains(sink) == false);
 
-            _applicationClients.push_back(sink);
+            _applicationClients.Add(sink);
             sink->AddRef();
 
             _adminLock.Unlock();
@@ -1850,18 +2150,20 @@ static GSourceFuncs _handlerIntervention =
         {
             _adminLock.Lock();
 
-            std::list<Exchange::IApplication::INotification*>::iterator index(std::find(_applicationClients.begin(), _applicationClients.end(), sink));
+            auto lane = _applicationClients.Remove(sink);
+
+            _adminLock.Unlock();
 
             // Make sure you do not unregister something you did not register !!!
-            ASSERT(index != _applicationClients.end());
+            ASSERT(lane != nullptr);
 
-            if (index != _applicationClients.end()) {
-                (*index)->Release();
-                _applicationClients.erase(index);
+            if (lane != nullptr) {
+                // A notification might be on its way to this sink right now.
+                lane->Close();
+                Retire(std::move(lane));
+                sink->Release();
                 TRACE(Trace::Information, (_T("Unregistered an IApplication sink from the browser %p"), sink));
             }
-
-            _adminLock.Unlock();
         }
 
         uint32_t Reset(VARIABLE_IS_NOT_USED const resettype type) override
@@ -1949,19 +2251,15 @@ static GSourceFuncs _handlerIntervention =
                 return Core::ERROR_GENERAL;
             }
 
-            using SetLanguagesData = std::tuple<WebKitImplementation*, Core::JSON::ArrayType<Core::JSON::String> >;
-            auto* data = new SetLanguagesData(this, array);
-            g_main_context_invoke_full(
-                _context,
-                G_PRIORITY_DEFAULT,
-                [](gpointer customdata) -> gboolean {
-                    auto& data = *static_cast<SetLanguagesData*>(customdata);
-                    WebKitImplementation* object = std::get<0>(data);
-                    Core::JSON::ArrayType<Core::JSON::String> array = std::get<1>(data);
+            // The array was validated above, the WebKit thread only has to re-read it.
+            _commands.Post(
+                [](WebKitImplementation& object, const CommandQueue::Command& command) {
+                    Core::JSON::ArrayType<Core::JSON::String> array;
+                    array.FromString(command.Payload);
 
-                    object->_adminLock.Lock();
-                    object->_config.Languages = array;
-                    object->_adminLock.Unlock();
+                    object._adminLock.Lock();
+                    object._config.Languages = array;
+                    object._adminLock.Unlock();
 
 #ifdef WEBKIT_GLIB_API
                     auto* languages = static_cast<char**>(g_new0(char*, array.Length() + 1));
@@ -1970,7 +2268,7 @@ static GSourceFuncs _handlerIntervention =
                     for (unsigned i = 0; index.Next(); ++i)
                         languages[i] = g_strdup(index.Current().Value().c_str());
 
-                    WebKitWebContext* context = webkit_web_view_get_context(object->_view);
+                    WebKitWebContext* context = webkit_web_view_get_context(object._view);
                     webkit_web_context_set_preferred_languages(context, languages);
                     g_strfreev(languages);
 #else
@@ -1984,42 +2282,59 @@ static GSourceFuncs _handlerIntervention =
                         WKRelease(itemString);
                     }
 
-                    auto context = WKPageGetContext(object->_page);
+                    auto context = WKPageGetContext(object._page);
                     WKSoupSessionSetPreferredLanguages(context, languages);
                     WKRelease(languages);
 #endif
-                    return G_SOURCE_REMOVE;
                 },
-                data,
-                [](gpointer customdata) {
-                    delete static_cast<SetLanguagesData*>(customdata);
-                });
+                language);
 
             return Core::ERROR_NONE;
         }
 
-        void OnURLChanged(const string& URL)
+        template <typename INTERFACE>
+        void Notify(const SubscriberList<INTERFACE>& list, typename Notifier<INTERFACE>::Handler handler, const string& text = string(), const int32_t value = 0) const
         {
             _adminLock.Lock();
+            typename SubscriberList<INTERFACE>::Snapshot subscribers(list.Current());
+            _adminLock.Unlock();
 
-            _URL = URL;
-
-            std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
-            {
-                while (index != _notificationClients.end()) {
-                    (*index)->URLChange(URL, false);
-                    index++;
-                }
+            for (const auto& subscriber : *subscribers) {
+                subscriber.Lane->Submit(handler, text, value);
             }
-            {
-                std::list<Exchange::IBrowser::INotification*>::iterator index(_notificationBrowserClients.begin());
-                while (index != _notificationBrowserClients.end()) {
-                    (*index)->URLChanged(URL);
-                    index++;
+        }
+
+        // A Notifier closed from its own thread, by a sink unregistering from within its own
+        // notification, cannot be joined there. It is kept until another thread can do that.
+        void Retire(std::shared_ptr<Core::Thread>&& lane)
+        {
+            std::vector<std::shared_ptr<Core::Thread>> joinable;
+
+            _adminLock.Lock();
+            _retiredLanes.push_back(std::move(lane));
+            for (auto index = _retiredLanes.begin(); index != _retiredLanes.end();) {
+                if ((*index)->Id() != Core::Thread::ThreadId()) {
+                    joinable.push_back(std::move(*index));
+                    index = _retiredLanes.erase(index);
+                } else {
+                    ++index;
                 }
             }
+            _adminLock.Unlock();
+        }
 
+        void OnURLChanged(const string& URL)
+        {
+            _adminLock.Lock();
+            _URL = URL;
             _adminLock.Unlock();
+
+            Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent& event) {
+                client->URLChange(event.Text, false);
+            }, URL);
+            Notify(_notificationBrowserClients, [](Exchange::IBrowser::INotification* client, const NotifierEvent& event) {
+                client->URLChanged(event.Text);
+            }, URL);
         }
 
 #ifndef WEBKIT_GLIB_API
@@ -2035,89 +2350,63 @@ static GSourceFuncs _handlerIntervention =
         void OnLoadFinished(const string& URL)
         {
             _adminLock.Lock();
-
             _URL = URL;
-            {
-                std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
-
-                while (index != _notificationClients.end()) {
-                    (*index)->LoadFinished(URL, _httpStatusCode);
-                    index++;
-                }
-            }
-            {
-                std::list<Exchange::IBrowser::INotification*>::iterator index(_notificationBrowserClients.begin());
-
-                while (index != _notificationBrowserClients.end()) {
-                    (*index)->LoadFinished(URL);
-                    index++;
-                }
-            }
-
             _adminLock.Unlock();
+
+            Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent& event) {
+                client->LoadFinished(event.Text, event.Value);
+            }, URL, _httpStatusCode);
+            Notify(_notificationBrowserClients, [](Exchange::IBrowser::INotification* client, const NotifierEvent& event) {
+                client->LoadFinished(event.Text);
+            }, URL);
         }
         void OnLoadFailed(const string& URL)
         {
-            _adminLock.Lock();
-
-            std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
-
-            while (index != _notificationClients.end()) {
-                (*index)->LoadFailed(URL);
-                index++;
-            }
-
-            _adminLock.Unlock();
+            Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent& event) {
+                client->LoadFailed(event.Text);
+            }, URL);
         }
         void OnStateChange(const PluginHost::IStateControl::state newState)
         {
             _adminLock.Lock();
 
-            if (_state != newState) {
-                _state = newState;
+            bool changed = (_state != newState);
+            _state = newState;
 
-                std::list<PluginHost::IStateControl::INotification*>::iterator index(_stateControlClients.begin());
+            _adminLock.Unlock();
 
-                while (index != _stateControlClients.end()) {
-                    (*index)->StateChange(newState);
-                    index++;
+            if (changed == true) {
+                if (_hangDetector != nullptr) {
+                    _hangDetector->Rearm();
                 }
+                Notify(_stateControlClients, [](PluginHost::IStateControl::INotification* client, const NotifierEvent& event) {
+                    client->StateChange(static_cast<PluginHost::IStateControl::state>(event.Value));
+                }, string(), newState);
             }
-
-            _adminLock.Unlock();
         }
         void Hidden(const bool hidden)
         {
             _adminLock.Lock();
 
-            if (hidden != _hidden) {
-                _hidden = hidden;
+            bool changed = (hidden != _hidden);
+            _hidden = hidden;
 
-                {
-                    std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
+            _adminLock.Unlock();
 
-                    while (index != _notificationClients.end()) {
-                        (*index)->VisibilityChange(hidden);
-                        index++;
-                    }
-                }
-                {
-                    std::list<Exchange::IBrowser::INotification*>::iterator index(_notificationBrowserClients.begin());
-                    while (index != _notificationBrowserClients.end()) {
-                        (*index)->Hidden(hidden);
-                        index++;
-                    }
-                }
-                {
-                    std::list<Exchange::IApplication::INotification*>::iterator index(_applicationClients.begin());
-                    while (index != _applicationClients.end()) {
-                        (*index)->VisibilityChange(hidden);
-                        index++;
-                    }
+            if (changed == true) {
+                if (_hangDetector != nullptr) {
+                    _hangDetector->Rearm();
                 }
+                Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent& event) {
+                    client->VisibilityChange(event.Value != 0);
+                }, string(), hidden);
+                Notify(_notificationBrowserClients, [](Exchange::IBrowser::INotification* client, const NotifierEvent& event) {
+                    client->Hidden(event.Value != 0);
+                }, string(), hidden);
+                Notify(_applicationClients, [](Exchange::IApplication::INotification* client, const NotifierEvent& event) {
+                    client->VisibilityChange(event.Value != 0);
+                }, string(), hidden);
             }
-
-            _adminLock.Unlock();
         }
         void OnJavaScript(const std::vector<string>& text) const
         {
@@ -2127,16 +2416,9 @@ static GSourceFuncs _handlerIntervention =
         }
         void OnBridgeQuery(const string& text)
         {
-            _adminLock.Lock();
-
-            std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
-
-            while (index != _notificationClients.end()) {
-                (*index)->BridgeQuery(text);
-                index++;
-            }
-
-            _adminLock.Unlock();
+            Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent& event) {
+                client->BridgeQuery(event.Text);
+            }, text);
         }
 
         void SetResponseHTTPStatusCode(int32_t code)
@@ -2177,6 +2459,10 @@ static GSourceFuncs _handlerIntervention =
                 _URL = _config.URL.Value();
             }
 
+            #if defined(ENABLE_CLOUD_COOKIE_JAR)
+            _cookieJar.DeltaMode(_config.CloudCookieJarDelta.Value());
+            #endif
+
             Core::SystemInfo::SetEnvironment(_T("QUEUEPLAYER_FLUSH_MODE"), _T("3"), false);
             Core::SystemInfo::SetEnvironment(_T("HOME"), service->PersistentPath());
 
@@ -2376,27 +2662,12 @@ static GSourceFuncs _handlerIntervention =
 
         void NotifyClosure()
         {
-            _adminLock.Lock();
-
-            {
-
-                std::list<Exchange::IWebBrowser::INotification*>::iterator index(_notificationClients.begin());
-
-                while (index != _notificationClients.end()) {
-                    (*index)->PageClosure();
-                    index++;
-                }
-            }
-            {
-                std::list<Exchange::IBrowser::INotification*>::iterator index(_notificationBrowserClients.begin());
-
-                while (index != _notificationBrowserClients.end()) {
-                    (*index)->Closure();
-                    index++;
-                }
-            }
-
-            _adminLock.Unlock();
+            Notify(_notificationClients, [](Exchange::IWebBrowser::INotification* client, const NotifierEvent&) {
+                client->PageClosure();
+            });
+            Notify(_notificationBrowserClients, [](Exchange::IBrowser::INotification* client, const NotifierEvent&) {
+                client->Closure();
+            });
         }
 
         void SetFPS()
@@ -2456,47 +2727,54 @@ static GSourceFuncs _handlerIntervention =
         END_INTERFACE_MAP
 
     private:
+        // WebKit thread only, from a command or a callback of its main loop.
+        void LoadURL(const string& url)
+        {
+            _adminLock.Lock();
+            _URL = url;
+            _adminLock.Unlock();
+
+            SetResponseHTTPStatusCode(-1);
+#ifdef WEBKIT_GLIB_API
+            webkit_web_view_load_uri(_view, _URL.c_str());
+#else
+            SetNavigationRef(nullptr);
+            auto shellURL = WKURLCreateWithUTF8CString(_URL.c_str());
+            WKPageLoadURL(_page, shellURL);
+            WKRelease(shellURL);
+#endif
+        }
         void Hide()
         {
             if (_context != nullptr) {
                 _time = Core::Time::Now().Ticks();
-                g_main_context_invoke(
-                    _context,
-                    [](gpointer customdata) -> gboolean {
-                        WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command&) {
 #ifdef WEBKIT_GLIB_API
-                        webkit_web_view_hide(object->_view);
+                        webkit_web_view_hide(object._view);
 #else
-                        WKViewSetViewState(object->_view, (object->_state == PluginHost::IStateControl::RESUMED ? kWKViewStateIsInWindow : 0));
+                        WKViewSetViewState(object._view, (object._state == PluginHost::IStateControl::RESUMED ? kWKViewStateIsInWindow : 0));
 #endif
-                        object->Hidden(true);
-                        TRACE_GLOBAL(Trace::Information, (_T("Internal Hide Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object->_time)));
-
-                        return FALSE;
-                    },
-                    this);
+                        object.Hidden(true);
+                        TRACE_GLOBAL(Trace::Information, (_T("Internal Hide Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object._time)));
+                    });
             }
         }
         void Show()
         {
             if (_context != nullptr) {
                 _time = Core::Time::Now().Ticks();
-                g_main_context_invoke(
-                    _context,
-                    [](gpointer customdata) -> gboolean {
-                        WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command&) {
 #ifdef WEBKIT_GLIB_API
-                        webkit_web_view_show(object->_view);
+                        webkit_web_view_show(object._view);
 #else
-                        WKViewSetViewState(object->_view, (object->_state == PluginHost::IStateControl::RESUMED ? kWKViewStateIsInWindow : 0) | kWKViewStateIsVisible);
+                        WKViewSetViewState(object._view, (object._state == PluginHost::IStateControl::RESUMED ? kWKViewStateIsInWindow : 0) | kWKViewStateIsVisible);
 #endif
-                        object->Hidden(false);
+                        object.Hidden(false);
 
-                        TRACE_GLOBAL(Trace::Information, (_T("Internal Show Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object->_time)));
-
-                        return FALSE;
-                    },
-                    this);
+                        TRACE_GLOBAL(Trace::Information, (_T("Internal Show Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object._time)));
+                    });
             }
         }
         void Suspend()
@@ -2505,30 +2783,25 @@ static GSourceFuncs _handlerIntervention =
                 _state = PluginHost::IStateControl::SUSPENDED;
             } else {
                 _time = Core::Time::Now().Ticks();
-                g_main_context_invoke(
-                    _context,
-                    [](gpointer customdata) -> gboolean {
-                        WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
-                        if (object->_config.LoadBlankPageOnSuspendEnabled.Value()) {
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command&) {
+                        if (object._config.LoadBlankPageOnSuspendEnabled.Value()) {
                             const char kBlankURL[] = "about:blank";
-                            if (object->_URL != kBlankURL)
-                                object->SetURL(kBlankURL);
-                            ASSERT(object->_URL == kBlankURL);
+                            if (object._URL != kBlankURL)
+                                object.LoadURL(kBlankURL);
+                            ASSERT(object._URL == kBlankURL);
                         }
 #ifdef WEBKIT_GLIB_API
-                        webkit_web_view_suspend(object->_view);
+                        webkit_web_view_suspend(object._view);
 #else
-                        WKViewSetViewState(object->_view, (object->_hidden ? 0 : kWKViewStateIsVisible));
+                        WKViewSetViewState(object._view, (object._hidden ? 0 : kWKViewStateIsVisible));
 #endif
-                        object->OnStateChange(PluginHost::IStateControl::SUSPENDED);
-
-                        TRACE_GLOBAL(Trace::Information, (_T("Internal Suspend Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object->_time)));
+                        object.OnStateChange(PluginHost::IStateControl::SUSPENDED);
 
-                        object->CheckWebProcess();
+                        TRACE_GLOBAL(Trace::Information, (_T("Internal Suspend Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object._time)));
 
-                        return FALSE;
-                    },
-                    this);
+                        object.CheckWebProcess();
+                    });
             }
         }
         void Resume()
@@ -2538,22 +2811,17 @@ static GSourceFuncs _handlerIntervention =
             } else {
                 _time = Core::Time::Now().Ticks();
 
-                g_main_context_invoke(
-                    _context,
-                    [](gpointer customdata) -> gboolean {
-                        WebKitImplementation* object = static_cast<WebKitImplementation*>(customdata);
+                _commands.Post(
+                    [](WebKitImplementation& object, const CommandQueue::Command&) {
 #ifdef WEBKIT_GLIB_API
-                        webkit_web_view_resume(object->_view);
+                        webkit_web_view_resume(object._view);
 #else
-                        WKViewSetViewState(object->_view, (object->_hidden ? 0 : kWKViewStateIsVisible) | kWKViewStateIsInWindow);
+                        WKViewSetViewState(object._view, (object._hidden ? 0 : kWKViewStateIsVisible) | kWKViewStateIsInWindow);
 #endif
-                        object->OnStateChange(PluginHost::IStateControl::RESUMED);
+                        object.OnStateChange(PluginHost::IStateControl::RESUMED);
 
-                        TRACE_GLOBAL(Trace::Information, (_T("Internal Resume Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object->_time)));
-
-                        return FALSE;
-                    },
-                    this);
+                        TRACE_GLOBAL(Trace::Information, (_T("Internal Resume Notification took %d mS."), static_cast<uint32_t>(Core::Time::Now().Ticks() - object._time)));
+                    });
             }
         }
 #ifdef WEBKIT_GLIB_API
@@ -2561,7 +2829,7 @@ static GSourceFuncs _handlerIntervention =
         {
             webkit_web_context_set_web_extensions_directory(context, browser->_extensionPath.c_str());
             // FIX it
-            GVariant* data = g_variant_new("(smsb)", std::to_string(browser->_guid).c_str(), !browser->_config.Whitelist.Value().empty() ? browser->_config.Whitelist.Value().c_str() : nullptr, browser->_config.LogToSystemConsoleEnabled.Value());
+            GVariant* data = g_variant_new("(smsbb)", std::to_string(browser->_guid).c_str(), !browser->_config.Whitelist.Value().empty() ? browser->_config.Whitelist.Value().c_str() : nullptr, browser->_config.LogToSystemConsoleEnabled.Value(), browser->_config.RawBridgeMessages.Value());
             webkit_web_context_set_web_extensions_initialization_user_data(context, data);
         }
         static void wpeNotifyWPEFrameworkMessageReceivedCallback(WebKitUserContentManager*, WebKitJavascriptResult* message, WebKitImplementation* browser)
@@ -2676,15 +2944,21 @@ static GSourceFuncs _handlerIntervention =
             const char* name = webkit_user_message_get_name(message);
             if (g_strcmp0(name, Tags::BridgeObjectQuery) == 0) {
                 GVariant* payload;
-                const char* payloadPtr;
 
                 payload = webkit_user_message_get_parameters(message);
                 if (!payload) {
                     return false;
                 }
-                g_variant_get(payload, "&s", &payloadPtr);
-                string payloadStr(payloadPtr);
-                browser->OnBridgeQuery(payloadStr);
+                if (g_variant_is_of_type(payload, G_VARIANT_TYPE_BYTESTRING) == TRUE) {
+                    gsize payloadLen = 0;
+                    const gchar* payloadPtr = static_cast<const gchar*>(g_variant_get_fixed_array(payload, &payloadLen, sizeof(gchar)));
+                    browser->OnBridgeQuery(string(payloadPtr, payloadLen));
+                } else {
+                    const char* payloadPtr;
+                    g_variant_get(payload, "&s", &payloadPtr);
+                    string payloadStr(payloadPtr);
+                    browser->OnBridgeQuery(payloadStr);
+                }
             }
             return true;
         }
@@ -2698,8 +2972,10 @@ static GSourceFuncs _handlerIntervention =
             _context = g_main_context_new();
             _loop = g_main_loop_new(_context, FALSE);
             g_main_context_push_thread_default(_context);
+            _commands.Open(_context);
 
             HangDetector hangdetector(*this);
+            _hangDetector = &hangdetector;
 
             bool automationEnabled = _config.Automation.Value();
 
@@ -2954,6 +3230,10 @@ static GSourceFuncs _handlerIntervention =
             _adminLock.Unlock();
 
             g_main_loop_run(_loop);
+            _hangDetector = nullptr;
+
+            // Whatever did not make it to the WebKit thread in time is dropped.
+            _commands.Close();
 
             if (frameDisplayedCallbackID)
                 webkit_web_view_remove_frame_displayed_callback(_view, frameDisplayedCallbackID);
@@ -2973,8 +3253,10 @@ static GSourceFuncs _handlerIntervention =
             _context = g_main_context_new();
             _loop = g_main_loop_new(_context, FALSE);
             g_main_context_push_thread_default(_context);
+            _commands.Open(_context);
 
             HangDetector hangdetector(*this);
+            _hangDetector = &hangdetector;
 
             auto contextConfiguration = WKContextConfigurationCreate();
 
@@ -3199,6 +3481,10 @@ static GSourceFuncs _handlerIntervention =
             _configurationCompleted.SetState(true);
 
             g_main_loop_run(_loop);
+            _hangDetector = nullptr;
+
+            // Whatever did not make it to the WebKit thread in time is dropped.
+            _commands.Close();
 
             // Seems if we stop the mainloop but are not in a suspended state, there is a crash.
             // Force suspended state first.
@@ -3246,18 +3532,66 @@ static GSourceFuncs _handlerIntervention =
 #endif
         }
 
+        // User scripts are shared by all browser instances in this process and survive a
+        // deactivation, they are only read again if the file size or modification time changed.
+        static bool UserScriptSource(const std::string& path, std::string& source)
+        {
+            struct Entry {
+                off_t Size;
+                time_t Modified;
+                long ModifiedNs;
+                std::string Source;
+            };
+            static std::unordered_map<std::string, Entry> cache;
+            static Core::CriticalSection cacheLock;
+
+            struct stat info;
+            if (::stat(path.c_str(), &info) != 0) {
+                return (false);
+            }
+
+            bool result = false;
+
+            cacheLock.Lock();
+            auto index = cache.find(path);
+            if ((index != cache.end()) && (index->second.Size == info.st_size) && (index->second.Modified == info.st_mtim.tv_sec) && (index->second.ModifiedNs == info.st_mtim.tv_nsec)) {
+                source = index->second.Source;
+                result = true;
+            }
+            cacheLock.Unlock();
+
+            if (result == false) {
+                gchar* scriptContent;
+                gsize scriptLength;
+                if (g_file_get_contents(path.c_str(), &scriptContent, &scriptLength, nullptr)) {
+                    source.assign(scriptContent, scriptLength);
+                    g_free(scriptContent);
+
+                    cacheLock.Lock();
+                    Entry& entry = cache[path];
+                    entry.Size = info.st_size;
+                    entry.Modified = info.st_mtim.tv_sec;
+                    entry.ModifiedNs = info.st_mtim.tv_nsec;
+                    entry.Source = source;
+                    cacheLock.Unlock();
+
+                    result = true;
+                }
+            }
+
+            return (result);
+        }
+
         void TryLoadingUserScripts()
         {
             if (_config.UserScripts.IsSet()) {
                 auto loadScript = [&](const std::string& path) {
-                    gchar* scriptContent;
-                    auto success = g_file_get_contents(path.c_str(), &scriptContent, nullptr, nullptr);
-                    if (!success) {
+                    std::string scriptContent;
+                    if (UserScriptSource(path, scriptContent) == false) {
                         SYSLOG(Trace::Error, (_T("Unable to read user script '%s'"), path.c_str()));
                         return;
                     }
-                    AddUserScriptImpl(scriptContent, false);
-                    g_free(scriptContent);
+                    AddUserScriptImpl(scriptContent.c_str(), false);
                 };
                 for (unsigned userScriptIndex = 0; userScriptIndex < _config.UserScripts.Length(); userScriptIndex++) {
                     const auto& scriptPath = _config.UserScripts[userScriptIndex].Value();
@@ -3278,23 +3612,88 @@ static GSourceFuncs _handlerIntervention =
                 // The file is used to share the data between WebKit processes.
                 // Filter storage path is the same for all browser instances: <cache_dir>/content_filters
                 // Individual filter is put inside storage path as a file named ContentFilterList-<identifier>
-                // where <identifier> is taken from webkit_user_content_filter_store_save() param
-                // (_service->Callsign().c_str() in this case).
-                // Each browser instance will have its own, single filter file, e.g.:
-                //   <cache_dir>/content_filters/ContentFilterList-HtmlApp-0
+                // where <identifier> is the callsign followed by a hash of the filter source, e.g.:
+                //   <cache_dir>/content_filters/ContentFilterList-HtmlApp-0-3f9a0c1d2e4b5a69
+                // A filter compiled by an earlier run from the same source is loaded as is, it is only
+                // (re)compiled when the source changed, after which the stale ones of this callsign are removed.
+                struct FilterRequest {
+                    WebKitImplementation* Browser;
+                    WebKitUserContentFilterStore* Store;
+                    GBytes* Source;
+                    string Identifier;
+                };
+
                 gchar* filtersPath = g_build_filename(g_get_user_cache_dir(), "content_filters", nullptr);
-                WebKitUserContentFilterStore* store = webkit_user_content_filter_store_new(filtersPath);
+                gchar* hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                    reinterpret_cast<const guchar*>(_config.ContentFilter.Value().c_str()), _config.ContentFilter.Value().size());
+
+                FilterRequest* request = new FilterRequest;
+                request->Browser = this;
+                request->Store = webkit_user_content_filter_store_new(filtersPath);
+                request->Source = g_bytes_new(_config.ContentFilter.Value().c_str(), _config.ContentFilter.Value().size());
+                request->Identifier = _service->Callsign() + '-' + string(hash, 16);
+
+                g_free(hash);
                 g_free(filtersPath);
-                GBytes* data = g_bytes_new(_config.ContentFilter.Value().c_str(), _config.ContentFilter.Value().size());
 
-                webkit_user_content_filter_store_save(store, _service->Callsign().c_str(), data, nullptr, [](GObject* obj, GAsyncResult* result, gpointer data) {
-                    WebKitImplementation* webkit_impl = static_cast<WebKitImplementation*>(data);
-                    WebKitUserContentFilter* filter = webkit_user_content_filter_store_save_finish(WEBKIT_USER_CONTENT_FILTER_STORE(obj), result, nullptr);
-                    auto* userContentManager = webkit_web_view_get_user_content_manager(webkit_impl->_view);
-                    webkit_user_content_manager_add_filter(userContentManager, filter);
-                }, this);
+                static const auto apply = [](FilterRequest* request, WebKitUserContentFilter* filter) {
+                    if (filter != nullptr) {
+                        auto* userContentManager = webkit_web_view_get_user_content_manager(request->Browser->_view);
+                        webkit_user_content_manager_add_filter(userContentManager, filter);
+                        webkit_user_content_filter_unref(filter);
+                    }
+                };
+                static const auto release = [](FilterRequest* request) {
+                    g_bytes_unref(request->Source);
+                    g_object_unref(request->Store);
+                    delete request;
+                };
+
+                webkit_user_content_filter_store_load(request->Store, request->Identifier.c_str(), nullptr, [](GObject* obj, GAsyncResult* result, gpointer data) {
+                    FilterRequest* request = static_cast<FilterRequest*>(data);
+                    WebKitUserContentFilter* filter = webkit_user_content_filter_store_load_finish(WEBKIT_USER_CONTENT_FILTER_STORE(obj), result, nullptr);
+
+                    if (filter != nullptr) {
+                        TRACE_GLOBAL(Trace::Information, (_T("Reusing compiled content filter '%s'"), request->Identifier.c_str()));
+                        apply(request, filter);
+                        release(request);
+                        return;
+                    }
+
+                    webkit_user_content_filter_store_save(request->Store, request->Identifier.c_str(), request->Source, nullptr, [](GObject* obj, GAsyncResult* result, gpointer data) {
+                        FilterRequest* request = static_cast<FilterRequest*>(data);
+                        GError* error = nullptr;
+                        WebKitUserContentFilter* filter = webkit_user_content_filter_store_save_finish(WEBKIT_USER_CONTENT_FILTER_STORE(obj), result, &error);
 
-                g_bytes_unref(data);
+                        if (filter == nullptr) {
+                            SYSLOG(Logging::Error, (_T("Failed to compile content filter: %s"), (error != nullptr ? error->message : "unknown")));
+                            g_clear_error(&error);
+                            release(request);
+                            return;
+                        }
+
+                        apply(request, filter);
+
+                        webkit_user_content_filter_store_fetch_identifiers(request->Store, nullptr, [](GObject* obj, GAsyncResult* result, gpointer data) {
+                            FilterRequest* request = static_cast<FilterRequest*>(data);
+                            gchar** identifiers = webkit_user_content_filter_store_fetch_identifiers_finish(WEBKIT_USER_CONTENT_FILTER_STORE(obj), result);
+                            const string prefix(request->Browser->_service->Callsign());
+
+                            for (gchar** identifier = identifiers; (identifier != nullptr) && (*identifier != nullptr); ++identifier) {
+                                const string stale(*identifier);
+                                // Either the legacy unhashed one or <callsign>-<16 hex digits>, not those of a callsign sharing the prefix
+                                const bool ours = (stale == prefix) || ((stale.size() == request->Identifier.size()) && (stale.compare(0, prefix.size() + 1, prefix + '-') == 0)
+                                    && (stale.find_first_not_of("0123456789abcdef", prefix.size() + 1) == string::npos));
+                                if ((stale != request->Identifier) && (ours == true)) {
+                                    webkit_user_content_filter_store_remove(request->Store, stale.c_str(), nullptr, nullptr, nullptr);
+                                }
+                            }
+
+                            g_strfreev(identifiers);
+                            release(request);
+                        }, request);
+                    }, request);
+                }, request);
             }
 #else
         // GLIB only supported
@@ -3398,7 +3797,12 @@ static GSourceFuncs _handlerIntervention =
 #ifdef WEBKIT_GLIB_API
         static void isWebProcessResponsiveCallback(WebKitWebView*, GParamSpec*, WebKitImplementation* self)
         {
-            if (webkit_web_view_get_is_web_process_responsive(self->_view) == true) {
+            const bool responsive = webkit_web_view_get_is_web_process_responsive(self->_view);
+            if (self->_hangDetector != nullptr) {
+                self->_hangDetector->ResponsivenessChanged(responsive);
+            }
+
+            if (responsive == true) {
 
                 if (self->_unresponsiveReplyNum > 0) {
 
@@ -3413,6 +3817,9 @@ static GSourceFuncs _handlerIntervention =
         static void WebProcessDidBecomeResponsive(WKPageRef page, const void* clientInfo)
         {
             auto &self = *const_cast<WebKitImplementation*>(static_cast<const WebKitImplementation*>(clientInfo));
+            if (self._hangDetector != nullptr) {
+                self._hangDetector->ResponsivenessChanged(true);
+            }
             if (self._unresponsiveReplyNum > 0) {
 
                 std::string activeURL = GetPageActiveURL(page);
@@ -3458,16 +3865,18 @@ static GSourceFuncs _handlerIntervention =
 #endif
 #if defined(ENABLE_CLOUD_COOKIE_JAR)
         Plugin::CookieJar _cookieJar;
-        std::list<Exchange::IBrowserCookieJar::INotification*> _cookieJarClients;
+        SubscriberList<Exchange::IBrowserCookieJar::INotification> _cookieJarClients;
 #endif
         mutable Core::CriticalSection _adminLock;
         uint32_t _fps;
         GMainLoop* _loop;
         GMainContext* _context;
-        std::list<Exchange::IWebBrowser::INotification*> _notificationClients;
-        std::list<Exchange::IBrowser::INotification*> _notificationBrowserClients;
-        std::list<PluginHost::IStateControl::INotification*> _stateControlClients;
-        std::list<Exchange::IApplication::INotification*> _applicationClients;
+        SubscriberList<Exchange::IWebBrowser::INotification> _notificationClients;
+        SubscriberList<Exchange::IBrowser::INotification> _notificationBrowserClients;
+        SubscriberList<PluginHost::IStateControl::INotification> _stateControlClients;
+        SubscriberList<Exchange::IApplication::INotification> _applicationClients;
+        std::vector<std::shared_ptr<Core::Thread>> _retiredLanes;
+        CommandQueue _commands;
         PluginHost::IStateControl::state _state;
         bool _hidden;
         uint64_t _time;
@@ -3475,6 +3884,7 @@ static GSourceFuncs _handlerIntervention =
         Core::StateTrigger<bool> _configurationCompleted;
         bool _webProcessCheckInProgress;
         uint32_t _unresponsiveReplyNum;
+        HangDetector* _hangDetector; // WebKit thread only, set while its main loop runs
         unsigned _frameCount;
         gint64 _lastDumpTime;
     };
@@ -18,13 +18,15 @@
 **/
 
 #pragma once
+#include <chrono>
 #include <future>
 #include <functional>
-#include <map>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <websocketpp/frame.hpp>
-#include <boost/optional.hpp>
 
 #include "../JsonRpc/Request.h"
 #include "../JsonRpc/Response.h"
@@ -33,6 +35,15 @@
 #include "Module.h"
 #include "UtilsJsonRpc.h"
 #include "UtilsLogging.h"
+#include "tptimer.h"
+
+// Full message payloads are only logged when built with WEBSOCKETS_JSONRPC_TRACE_PAYLOADS,
+// formatting and flushing them for every message is too costly for the normal build.
+#ifdef WEBSOCKETS_JSONRPC_TRACE_PAYLOADS
+#define JSONRPC_TRACE_PAYLOAD(fmt, ...) LOGINFO(fmt, ##__VA_ARGS__)
+#else
+#define JSONRPC_TRACE_PAYLOAD(fmt, ...) do { } while (0)
+#endif
 
 namespace WebSockets   {
 
@@ -40,14 +51,25 @@ template<typename Derived>
 class JsonRpcInterface
 {
 public:
-    JsonRpcInterface() = default;
+    // Invoked exactly once per request sent with sendRequestAsync(): from the websocket thread with the
+    // response, from the timer thread on timeout, or from the destructor for requests still in flight then.
+    // success has the meaning of sendRequest()'s return value, response is nullptr if no response arrived.
+    // The timer thread is the process-wide TpTimer thread, a slow handler there delays every other timer
+    // of the process, hand longer work off to another thread.
+    using ResponseHandler = std::function<void(bool success, const JsonRpc::Response* response)>;
+
+    JsonRpcInterface();
 
     // Note: return value: sending result && receiving result && json-rpc's response field "success" value
     bool sendRequest(const JsonRpc::Request& request, JsonRpc::Response& response);
+    // Sends the request without waiting for the response, any number of requests can be in flight on the
+    // connection. Returns false (and never calls the handler) if the request couldn't be sent.
+    bool sendRequestAsync(const JsonRpc::Request& request, ResponseHandler handler,
+        std::chrono::milliseconds timeout = std::chrono::seconds(5));
     void setNotificationHandler(std::function<void(const JsonRpc::Notification&)> notificationHandler);
 
 protected:
-    ~JsonRpcInterface() = default;
+    ~JsonRpcInterface();
     void onMessage(const std::string& message);
 
     websocketpp::frame::opcode::value opcode_{websocketpp::frame::opcode::text};
@@ -56,50 +78,258 @@ private:
     JsonRpcInterface(const JsonRpcInterface&) = delete;
     JsonRpcInterface& operator=(const JsonRpcInterface&) = delete;
 
-    bool getAsyncResponse(uint32_t id, std::future<string>& futureReponse, JsonRpc::Response& response);
-    boost::optional<std::future<string> > createFutureResponse(uint32_t id);
-    void removePromise(uint32_t id);
-    bool isRequestProcessingOngoing(uint32_t id);
-    void handleNotification(const std::string& message);
-    void handleResponse(uint32_t id, const std::string& message);
-    bool processResponse(uint32_t id, const std::string &responseString, JsonRpc::Response &deviceResponse) const;
+    // Called with the parsed response, or with nullptr if the request timed out or was still pending on destruction.
+    using Completion = std::function<void(const std::shared_ptr<const JsonRpc::Response>& response)>;
+
+    static constexpr uint64_t noDeadline = std::numeric_limits<uint64_t>::max();
+    static constexpr uint32_t sweepIntervalMs = 100;
+
+    // Requests awaiting their response, keyed by id. Open addressing with linear probing over a power of two
+    // sized array and backward shift deletion, so lookups touch one or two adjacent slots and in-flight
+    // requests don't allocate a node each.
+    class PendingTable
+    {
+    public:
+        PendingTable() : entries_(16), size_(0) {}
+
+        bool insert(uint32_t id, uint64_t deadline, Completion&& completion);
+        bool contains(uint32_t id) const { return find(id) != npos; }
+        bool take(uint32_t id, Completion& completion);
+        void takeExpired(uint64_t now, std::vector<Completion>& expired);
+        bool empty() const { return size_ == 0; }
+
+    private:
+        struct Entry
+        {
+            uint32_t id = 0;
+            bool used = false;
+            uint64_t deadline = 0;
+            Completion completion;
+        };
+        static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+        size_t home(uint32_t id) const { return (id * 2654435769u) & (entries_.size() - 1); }
+        size_t find(uint32_t id) const;
+        void erase(size_t index);
+        void grow();
+
+        std::vector<Entry> entries_;
+        size_t size_;
+    };
+
+    static uint64_t now();
+    bool addPending(uint32_t id, uint64_t deadline, Completion&& completion);
+    void removePending(uint32_t id);
+    void sweepExpired();
+    void handleNotification(const JsonRpc::Response& message);
+    void handleResponse(const std::shared_ptr<const JsonRpc::Response>& response);
+    bool processResponse(uint32_t id, const JsonRpc::Response &deviceResponse) const;
 
     std::mutex responseMutex_;
-    std::map<uint32_t, std::promise<std::string> > responseToPromise_;
+    PendingTable pending_;
     std::function<void(const JsonRpc::Notification&)> notificationHandler_;
+    // last, so it is stopped before anything a sweep touches goes away
+    WPEFramework::Plugin::TpTimer sweepTimer_;
 };
 
+template<typename Derived>
+bool JsonRpcInterface<Derived>::PendingTable::insert(uint32_t id, uint64_t deadline, Completion&& completion)
+{
+    if (find(id) != npos)
+    {
+        return false;
+    }
+    if ((size_ + 1) * 2 > entries_.size())
+    {
+        grow();
+    }
+    size_t index = home(id);
+    while (entries_[index].used)
+    {
+        index = (index + 1) & (entries_.size() - 1);
+    }
+    entries_[index].id = id;
+    entries_[index].used = true;
+    entries_[index].deadline = deadline;
+    entries_[index].completion = std::move(completion);
+    ++size_;
+    return true;
+}
+
+template<typename Derived>
+bool JsonRpcInterface<Derived>::PendingTable::take(uint32_t id, Completion& completion)
+{
+    const size_t index = find(id);
+    if (index == npos)
+    {
+        return false;
+    }
+    completion = std::move(entries_[index].completion);
+    erase(index);
+    return true;
+}
+
+template<typename Derived>
+void JsonRpcInterface<Derived>::PendingTable::takeExpired(uint64_t now, std::vector<Completion>& expired)
+{
+    size_t index = 0;
+    while (index < entries_.size())
+    {
+        if (entries_[index].used && entries_[index].deadline <= now)
+        {
+            expired.push_back(std::move(entries_[index].completion));
+            // erasing shifts a later entry into this slot, look at it again
+            erase(index);
+            continue;
+        }
+        ++index;
+    }
+}
+
+template<typename Derived>
+size_t JsonRpcInterface<Derived>::PendingTable::find(uint32_t id) const
+{
+    size_t index = home(id);
+    while (entries_[index].used)
+    {
+        if (entries_[index].id == id)
+        {
+            return index;
+        }
+        index = (index + 1) & (entries_.size() - 1);
+    }
+    return npos;
+}
+
+template<typename Derived>
+void JsonRpcInterface<Derived>::PendingTable::erase(size_t index)
+{
+    const size_t mask = entries_.size() - 1;
+    size_t hole = index;
+    size_t next = (hole + 1) & mask;
+
+    // pull back every following entry of the probe run that may move into the hole
+    while (entries_[next].used)
+    {
+        const size_t wanted = home(entries_[next].id);
+        if (((next - wanted) & mask) >= ((next - hole) & mask))
+        {
+            entries_[hole] = std::move(entries_[next]);
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    entries_[hole].used = false;
+    entries_[hole].completion = nullptr;
+    --size_;
+}
+
+template<typename Derived>
+void JsonRpcInterface<Derived>::PendingTable::grow()
+{
+    std::vector<Entry> old(entries_.size() * 2);
+    old.swap(entries_);
+    size_ = 0;
+    for (auto& entry : old)
+    {
+        if (entry.used)
+        {
+            insert(entry.id, entry.deadline, std::move(entry.completion));
+        }
+    }
+}
+
+template<typename Derived>
+JsonRpcInterface<Derived>::JsonRpcInterface()
+{
+    sweepTimer_.connect([this]() { sweepExpired(); });
+}
+
+template<typename Derived>
+JsonRpcInterface<Derived>::~JsonRpcInterface()
+{
+    // no sweep runs any more after this, fail whatever is still waiting so every handler runs once
+    sweepTimer_.stop();
+
+    std::vector<Completion> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(responseMutex_);
+        pending_.takeExpired(noDeadline, abandoned);
+    }
+    for (auto& completion : abandoned)
+    {
+        completion(nullptr);
+    }
+}
+
 template<typename Derived>
 bool JsonRpcInterface<Derived>::sendRequest(const JsonRpc::Request& request, JsonRpc::Response& response)
 {
-    if (isRequestProcessingOngoing(request.getId()))
+    const uint32_t id = request.getId();
+    auto promise = std::make_shared<std::promise<std::shared_ptr<const JsonRpc::Response> > >();
+    std::future<std::shared_ptr<const JsonRpc::Response> > futureReponse = promise->get_future();
+
+    if (!addPending(id, noDeadline, [promise](const std::shared_ptr<const JsonRpc::Response>& received) {
+            if (received)
+            {
+                promise->set_value(received);
+            }
+        }))
     {
         LOGERR("Processing of request with ID:%d is already ongoing. Dropping new one:%s",
-            request.getId(), request.toString().c_str());
+            id, request.toString().c_str());
         return false;
     }
 
-    auto futureReponse = createFutureResponse(request.getId());
-    if (!futureReponse)
+    JSONRPC_TRACE_PAYLOAD("Sending json-rpc request: %s", request.toString().c_str());
+    Derived& derived = static_cast<Derived&>(*this);
+    if (!derived.send(request.toString()))
     {
-        LOGERR("Can't create future response.");
+        LOGERR("Sending request with ID:%d failed. Cleaning internal state.", id);
+        removePending(id);
         return false;
     }
 
-    LOGINFO("Sending json-rpc request: %s", request.toString().c_str());
-    Derived& derived = static_cast<Derived&>(*this);
-    if (derived.send(request.toString()))
+    if (futureReponse.wait_for(std::chrono::seconds(5)) != std::future_status::ready)
     {
-        // Using futureResponse in addition to request.getId() to not lock mutex and search again.
-        return getAsyncResponse(request.getId(), *futureReponse, response);
+        LOGERR("Timeout for request/response ID:%d", id);
+        removePending(id);
+        return false;
     }
-    else
+    response.assign(*futureReponse.get());
+    return processResponse(id, response);
+}
+
+template<typename Derived>
+bool JsonRpcInterface<Derived>::sendRequestAsync(const JsonRpc::Request& request, ResponseHandler handler,
+    std::chrono::milliseconds timeout)
+{
+    const uint32_t id = request.getId();
+
+    if (!addPending(id, now() + timeout.count(), [this, id, handler](const std::shared_ptr<const JsonRpc::Response>& received) {
+            if (!received)
+            {
+                LOGERR("No response for request ID:%d, timed out or connection gone", id);
+                handler(false, nullptr);
+                return;
+            }
+            handler(processResponse(id, *received), received.get());
+        }))
+    {
+        LOGERR("Processing of request with ID:%d is already ongoing. Dropping new one.", id);
+        return false;
+    }
+
+    JSONRPC_TRACE_PAYLOAD("Sending json-rpc request: %s", request.toString().c_str());
+    Derived& derived = static_cast<Derived&>(*this);
+    if (!derived.send(request.toString()))
     {
-        LOGERR("Sending request with ID:%d failed. Cleaning internal state.", request.getId());
-        removePromise(request.getId());
+        LOGERR("Sending request with ID:%d failed. Cleaning internal state.", id);
+        removePending(id);
         return false;
     }
-    return false;
+    return true;
 }
 
 template<typename Derived>
@@ -111,126 +341,122 @@ void JsonRpcInterface<Derived>::setNotificationHandler(std::function<void(const
 template<typename Derived>
 void JsonRpcInterface<Derived>::onMessage(const std::string& message)
 {
-    LOGINFO("On message: %s", message.c_str());
+    JSONRPC_TRACE_PAYLOAD("On message: %s", message.c_str());
 
-    JsonObject json;
-    if (!json.FromString(message))
+    // A single parse classifies the message, the parsed envelope is handed on from there. A response is
+    // kept in the shape its waiter gets it in, shared as that may outlive this call on the sync path.
+    std::shared_ptr<JsonRpc::Response> parsed = std::make_shared<JsonRpc::Response>();
+    if (!parsed->FromString(message))
     {
         LOGERR("Discarding message. Message contains malformed JSON: %s", message.c_str());
         return;
     }
-    if (json.HasLabel("id"))
+    if (parsed->Id.IsSet())
     {
-        LOGINFO("Message contains id field");
-        if (json.HasLabel("method"))
+        if (parsed->Designator.IsSet())
         {
             // TO DO: Implement when there will be use case for client receiving request
             // or when JsonRpcInterace will be used for SingleClientServer
         }
         else
         {
-            if (json["id"].Content() != WPEFramework::Core::JSON::Variant::type::NUMBER)
-            {
-                LOGERR("Received message contains ID field which is not a number. Dropping.");
-                return;
-            }
-            handleResponse(json["id"].Number(), message);
-            return;
+            handleResponse(parsed);
         }
     }
     else
     {
-        LOGINFO("Message doesn't contains id field");
-        handleNotification(message);
+        handleNotification(*parsed);
     }
 }
 
 template<typename Derived>
-bool JsonRpcInterface<Derived>::getAsyncResponse(uint32_t id, std::future<string>& futureReponse, JsonRpc::Response& response)
+uint64_t JsonRpcInterface<Derived>::now()
 {
-    switch (futureReponse.wait_for(std::chrono::seconds(5)))
-    {
-        case std::future_status::ready:
-            removePromise(id);
-            return processResponse(id, futureReponse.get(), response);
-        case std::future_status::timeout:
-            LOGERR("Timeout for request/response ID:%d", id);
-            removePromise(id);
-            return false;
-        case std::future_status::deferred:
-            LOGERR("Execution for request/response ID:%d deferred. Internal error.", id);  // "should not happen"
-            removePromise(id);
-            return false;
-    }
-    return false;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 template<typename Derived>
-boost::optional<std::future<string> > JsonRpcInterface<Derived>::createFutureResponse(uint32_t id)
+bool JsonRpcInterface<Derived>::addPending(uint32_t id, uint64_t deadline, Completion&& completion)
 {
     std::lock_guard<std::mutex> lock(responseMutex_);
-    auto insertionResult = responseToPromise_.emplace(std::make_pair(id, std::promise<std::string>{} ));
-    if (!insertionResult.second)
+    if (!pending_.insert(id, deadline, std::move(completion)))
     {
-        LOGERR("Request with the same ID:%d already saved.", id);
-        return boost::none;
+        return false;
+    }
+    if ((deadline != noDeadline) && !sweepTimer_.isActive())
+    {
+        sweepTimer_.start(sweepIntervalMs);
     }
-    return insertionResult.first->second.get_future();
+    return true;
 }
 
 template<typename Derived>
-void JsonRpcInterface<Derived>::removePromise(uint32_t id)
+void JsonRpcInterface<Derived>::removePending(uint32_t id)
 {
+    Completion completion;
     std::lock_guard<std::mutex> lock(responseMutex_);
-    responseToPromise_.erase(id);
+    pending_.take(id, completion);
 }
 
 template<typename Derived>
-bool JsonRpcInterface<Derived>::isRequestProcessingOngoing(uint32_t id)
+void JsonRpcInterface<Derived>::sweepExpired()
 {
-    std::lock_guard<std::mutex> lock(responseMutex_);
-    return responseToPromise_.count(id) != 0;
+    std::vector<Completion> expired;
+    {
+        std::lock_guard<std::mutex> lock(responseMutex_);
+        pending_.takeExpired(now(), expired);
+        if (pending_.empty())
+        {
+            sweepTimer_.stop();
+        }
+    }
+    for (auto& completion : expired)
+    {
+        completion(nullptr);
+    }
 }
 
 template<typename Derived>
-void JsonRpcInterface<Derived>::handleNotification(const std::string& message)
+void JsonRpcInterface<Derived>::handleNotification(const JsonRpc::Response& message)
 {
-    LOGINFO();
-    JsonRpc::Notification notif;
-    notif.FromString(message);
-    if (!notif.isValid())
+    if (!notificationHandler_)
     {
-        LOGERR("Malformed jsonrpc notification. Dropping.");
+        LOGINFO("No handler for notifications set. Dropping notification.");
         return;
     }
-    if (!notificationHandler_)
+    JsonRpc::Notification notif;
+    notif.assign(message);
+    if (!notif.isValid())
     {
-        LOGINFO("No handler for notifications set. Dropping notification.");
+        LOGERR("Malformed jsonrpc notification. Dropping.");
         return;
     }
     notificationHandler_(notif);
 }
 
 template<typename Derived>
-void JsonRpcInterface<Derived>::handleResponse(uint32_t id, const std::string& message)
+void JsonRpcInterface<Derived>::handleResponse(const std::shared_ptr<const JsonRpc::Response>& response)
 {
-    std::lock_guard<std::mutex> lock(responseMutex_);
-    const auto& idToPromise = responseToPromise_.find(id);
-    if (idToPromise == responseToPromise_.end())
+    const uint32_t id = response->getId();
+    Completion completion;
     {
-        LOGERR("Can't find request with id:%d. Dropping response.", id);
-        return;
-    };
-    idToPromise->second.set_value(message);
+        std::lock_guard<std::mutex> lock(responseMutex_);
+        if (!pending_.take(id, completion))
+        {
+            LOGERR("Can't find request with id:%d. Dropping response.", id);
+            return;
+        }
+    }
+    // outside of the lock, a handler may well send the next request
+    completion(response);
 }
 
 template<typename Derived>
-bool JsonRpcInterface<Derived>::processResponse(uint32_t id, const std::string &responseString, JsonRpc::Response &deviceResponse) const
+bool JsonRpcInterface<Derived>::processResponse(uint32_t id, const JsonRpc::Response &deviceResponse) const
 {
     bool success = false;
 
-    deviceResponse.FromString(responseString);
-
     if (deviceResponse.isValid() && (deviceResponse.getId() == id))
     {
         JsonObject parameters;
@@ -241,7 +467,7 @@ bool JsonRpcInterface<Derived>::processResponse(uint32_t id, const std::string &
             if (parameters.HasLabel("success"))
             {
                 getBoolParameter("success", success);
-                LOGINFO("Result success: %u", success);
+                JSONRPC_TRACE_PAYLOAD("Result success: %u", success);
             }
         }
 
@@ -0,0 +1,40 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2022 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+namespace WebSockets   {
+namespace JsonRpc      {
+
+// Copies one JSON-RPC envelope field, clearing the target if the source isn't set.
+template<typename FIELD>
+inline void copyField(FIELD& to, const FIELD& from)
+{
+    if (from.IsSet())
+    {
+        to = from.Value();
+    }
+    else
+    {
+        to.Clear();
+    }
+}
+
+}   // namespace JsonRpc
+}   // namespace WebSockets
@@ -18,6 +18,7 @@
 **/
 
 #include "Notification.h"
+#include "MessageFields.h"
 
 #include "UtilsLogging.h"
 
@@ -51,6 +52,14 @@ bool Notification::isValid() const
     return true;
 }
 
+void Notification::assign(const WPEFramework::Core::JSONRPC::Message& message)
+{
+    copyField(JSONRPC, message.JSONRPC);
+    copyField(Id, message.Id);
+    copyField(Designator, message.Designator);
+    copyField(Parameters, message.Parameters);
+}
+
 std::string Notification::toString() const
 {
     std::string request;
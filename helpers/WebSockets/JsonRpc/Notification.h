@@ -32,6 +32,8 @@ public:
 
     std::string toString() const;
     bool isValid() const;
+    // Copies jsonrpc, id, method and params from a message that has already been parsed
+    void assign(const WPEFramework::Core::JSONRPC::Message& message);
 private:
     Notification(const Notification&) = delete;
     Notification& operator=(const Notification&) = delete;
@@ -18,6 +18,7 @@
 **/
 
 #include "Response.h"
+#include "MessageFields.h"
 
 #include "UtilsLogging.h"
 
@@ -109,5 +110,19 @@ bool Response::isValid() const
     return true;
 }
 
+void Response::assign(const WPEFramework::Core::JSONRPC::Message& message)
+{
+    copyField(JSONRPC, message.JSONRPC);
+    copyField(Id, message.Id);
+    copyField(Result, message.Result);
+
+    Error.Clear();
+    if (message.Error.IsSet())
+    {
+        copyField(Error.Code, message.Error.Code);
+        copyField(Error.Text, message.Error.Text);
+    }
+}
+
 }   // namespace JsonRpc
 }   // namespace WebSockets
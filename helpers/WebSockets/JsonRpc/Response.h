@@ -36,6 +36,8 @@ public:
     bool isError() const;
     bool getError(JsonObject& jsonObject) const;
     bool isValid() const;
+    // Takes over the envelope of a message parsed elsewhere, saves parsing the text again
+    void assign(const WPEFramework::Core::JSONRPC::Message& message);
 
 private:
     Response(const Response&) = delete;
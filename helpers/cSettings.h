@@ -19,28 +19,47 @@
 
 #pragma once
 
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
 #include <plugins/plugins.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "UtilsfileExists.h"
+#include "tptimer.h"
 
 using namespace std;
 
 class cSettings {
     std::string filename;
     JsonObject data;
+    WPEFramework::Core::CriticalSection lock;
+    /* write-behind: 0 writes every change through, else the ms changes are batched for */
+    int writeBehindMs;
+    bool dirty;
+    bool flushScheduled;
+    WPEFramework::Plugin::TpTimer flushTimer;
 
 public:
     /***
      * @brief    : Constructor.
+     * @param1[in]   : <string> file
+     * @param2[in]   : <int> write-behind window in ms, 0 (default) to write every change through.
+     *                 Otherwise changes are kept in memory and written in one go once the window
+     *                 after the first unsaved change has passed, on flush() or on destruction.
      * @return   : nil.
      */
-    cSettings(std::string file)
+    cSettings(std::string file, int writeBehindWindowMs = 0)
+        : writeBehindMs(writeBehindWindowMs)
+        , dirty(false)
+        , flushScheduled(false)
     {
         filename = file;
+        flushTimer.connect([this]() { onFlushTimer(); });
         if (!readFromFile()) {
             /* File not present; create a new one assuming a fresh partition. */
             std::fstream fs;
@@ -55,10 +74,14 @@ public:
     }
 
     /***
-     * @brief    : Destructor.
+     * @brief    : Destructor, writes out pending changes.
      * @return   : nil.
      */
-    ~cSettings() = default;
+    ~cSettings()
+    {
+        flushTimer.stop();
+        flush();
+    }
 
     /***
      * @brief        : Get value of given key.
@@ -67,7 +90,10 @@ public:
      */
     JsonValue getValue(std::string key)
     {
-        return data.Get(key.c_str());
+        lock.Lock();
+        JsonValue value = data.Get(key.c_str());
+        lock.Unlock();
+        return value;
     }
 
     /***
@@ -78,8 +104,11 @@ public:
      */
     bool setValue(std::string key, std::string value)
     {
+        lock.Lock();
         data[key.c_str()] = value;
-        return writeToFile();
+        bool status = commit();
+        lock.Unlock();
+        return status;
     }
 
     /***
@@ -90,8 +119,11 @@ public:
      */
     bool setValue(std::string key, int value)
     {
+        lock.Lock();
         data[key.c_str()] = value;
-        return writeToFile();
+        bool status = commit();
+        lock.Unlock();
+        return status;
     }
 
     /***
@@ -102,8 +134,11 @@ public:
      */
     bool setValue(std::string key, bool value)
     {
+        lock.Lock();
         data[key.c_str()] = value;
-        return writeToFile();
+        bool status = commit();
+        lock.Unlock();
+        return status;
     }
 
     /***
@@ -114,6 +149,7 @@ public:
     bool contains(std::string key)
     {
         bool resp = false;
+        lock.Lock();
         if (data.HasLabel(key.c_str())) {
             if (data[key.c_str()].String().empty()) {
                 resp = false;
@@ -123,6 +159,7 @@ public:
         } else {
             resp = false;
         }
+        lock.Unlock();
         return resp;
     }
 
@@ -134,6 +171,7 @@ public:
     bool remove(std::string key)
     {
         bool status = false;
+        lock.Lock();
         /*
          * Noticed that there is an error with the Remove function.
          * work around is to assign a null value to the key and handle it
@@ -142,7 +180,7 @@ public:
         data[key.c_str()] = "";
         data.Remove(key.c_str());
         if (!contains(key)) {
-            if (writeToFile()) {
+            if (commit()) {
                 status = true;
             } else {
                 status = false;
@@ -150,6 +188,22 @@ public:
         } else {
             status = false;
         }
+        lock.Unlock();
+        return status;
+    }
+
+    /***
+     * @brief    : Write out pending changes now, if there are any.
+     * @return   : <bool> False if the changes couldn't be written, else True.
+     */
+    bool flush()
+    {
+        bool status = true;
+        lock.Lock();
+        if (dirty) {
+            status = writeToFile();
+        }
+        lock.Unlock();
         return status;
     }
 
@@ -161,24 +215,53 @@ public:
     {
         bool status = false;
 
+        lock.Lock();
         if (Utils::fileExists(filename.c_str())) {
-            ofstream ofile;
-            ofile.open(filename.c_str(), ios::out);
-            if (ofile) {
-                JsonObject::Iterator iterator = data.Variants();
-                while (iterator.Next()) {
-                    if (!data[iterator.Label()].String().empty()) {
-                        ofile << iterator.Label() << "=" << data[iterator.Label()].String() << endl;
-                    } else {
-                        continue;
+            std::string content;
+            JsonObject::Iterator iterator = data.Variants();
+            while (iterator.Next()) {
+                if (!data[iterator.Label()].String().empty()) {
+                    content += iterator.Label();
+                    content += '=';
+                    content += data[iterator.Label()].String();
+                    content += '\n';
+                } else {
+                    continue;
+                }
+            }
+
+            /* replace the file atomically, so a power cut never leaves a truncated one behind */
+            std::string tmpname = filename + ".tmp";
+            struct stat st;
+            mode_t mode = (stat(filename.c_str(), &st) == 0) ? (st.st_mode & 07777) : 0644;
+            int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+            if (fd >= 0) {
+                fchmod(fd, mode);
+                size_t written = 0;
+                while (written < content.size()) {
+                    ssize_t result = write(fd, content.data() + written, content.size() - written);
+                    if (result <= 0) {
+                        break;
                     }
+                    written += result;
+                }
+                status = (written == content.size()) && (fsync(fd) == 0);
+                status = (close(fd) == 0) && status;
+                if (status) {
+                    status = (rename(tmpname.c_str(), filename.c_str()) == 0);
+                }
+                if (!status) {
+                    std::cout << "Error:[cSettings] unable to write configuration file." << std::endl;
+                    unlink(tmpname.c_str());
                 }
-                status = true;
-                ofile.close();
             } else {
                 status = false;
             }
         }
+        if (status) {
+            dirty = false;
+        }
+        lock.Unlock();
         return status;
     }
 
@@ -193,6 +276,7 @@ public:
         if (!Utils::fileExists(filename.c_str())) {
             return retStatus;
         }
+        lock.Lock();
         fstream ifile(filename, ios::in);
         if (ifile) {
             while (!ifile.eof()) {
@@ -206,6 +290,45 @@ public:
         } else {
             //Do nothing.
         }
+        lock.Unlock();
         return retStatus;
     }
+
+private:
+    /***
+     * @brief    : Persist a change, right away or in the next write-behind batch. Called with the lock held.
+     * @return   : <bool> False if the change couldn't be written, else True.
+     */
+    bool commit()
+    {
+        bool status = true;
+        dirty = true;
+        if (writeBehindMs <= 0) {
+            status = writeToFile();
+        } else if (!flushScheduled) {
+            /* the window starts with the first unsaved change, so a steady stream of changes still gets saved */
+            flushScheduled = true;
+            flushTimer.start(writeBehindMs);
+        }
+        return status;
+    }
+
+    /***
+     * @brief    : Write-behind timer, periodic while there are changes and stopped only here, under the
+     *             lock, once there is nothing left to write. commit() then arms it again, so a change made
+     *             while it winds down is never left without a scheduled write, and a failed write is retried.
+     * @return   : nil.
+     */
+    void onFlushTimer()
+    {
+        lock.Lock();
+        if (dirty) {
+            writeToFile();
+        } else {
+            /* called on the timer thread, stop() doesn't wait for this callback */
+            flushTimer.stop();
+            flushScheduled = false;
+        }
+        lock.Unlock();
+    }
 };
@@ -23,12 +23,306 @@
 //#include <core/Timer.h>
 #include <plugins/plugins.h>
 
+#include <algorithm>
+#include <chrono>
+
 namespace WPEFramework {
 
 namespace Plugin {
+    // One thread serving every TpTimer in the process. Timers are kept in a hierarchical timing wheel
+    // of 4 levels x 64 slots at 1 ms resolution (level n slots span 64^n ms, ~4.6 h in total, longer
+    // delays are parked in the last level and re-filed when it comes round). Scheduling and revoking
+    // is O(1): a job is an intrusive list node, a slot a list head and every level has an occupancy
+    // mask, so the thread finds the next expiry or cascade without scanning and sleeps until then.
+    class TpTimerService : public Core::Thread {
+    public:
+        class Job {
+        public:
+            Job(const Job&) = delete;
+            Job& operator=(const Job&) = delete;
+
+            Job() = default;
+            virtual ~Job() = default;
+
+            virtual void Timed() = 0;
+
+        private:
+            friend class TpTimerService;
+
+            Job* m_prev { nullptr };
+            Job* m_next { nullptr };
+            uint64_t m_expiry { 0 };
+            uint16_t m_list { Unlinked };
+        };
+
+    private:
+        static constexpr uint8_t SlotBits = 6;
+        static constexpr uint16_t Slots = (1 << SlotBits);
+        static constexpr uint8_t Levels = 4;
+        static constexpr uint16_t Expired = Levels * Slots;
+        static constexpr uint16_t Unlinked = Expired + 1;
+        static constexpr uint64_t Never = ~static_cast<uint64_t>(0);
+
+        TpTimerService()
+            : Core::Thread(64 * 1024, _T("ThunderPluginBaseTimer"))
+            , m_adminLock()
+            , m_dispatchLock()
+            , m_wakeup(false, true)
+            , m_heads()
+            , m_occupied()
+            , m_expiredTail(nullptr)
+            , m_now(Now())
+            , m_nextWakeup(Never)
+            , m_executing(nullptr)
+        {
+            Run();
+        }
+
+    public:
+        TpTimerService(const TpTimerService&) = delete;
+        TpTimerService& operator=(const TpTimerService&) = delete;
+
+        ~TpTimerService() override
+        {
+            Block();
+            m_wakeup.SetEvent();
+            Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+        }
+
+        static TpTimerService& Instance()
+        {
+            static TpTimerService instance;
+            return instance;
+        }
+
+        // (Re)schedules the job to fire once, delayMs from now.
+        void Schedule(Job& job, const uint32_t delayMs)
+        {
+            m_adminLock.Lock();
+
+            Unlink(job);
+
+            const uint64_t now = Now();
+            Advance(now);
+            job.m_expiry = now + delayMs;
+            File(job);
+
+            // the service thread recalculates its sleep after every job anyway
+            const bool wakeup = (Core::Thread::ThreadId() != Id()) && ((m_heads[Expired] != nullptr) || (job.m_expiry < m_nextWakeup));
+
+            m_adminLock.Unlock();
+
+            if (wakeup == true) {
+                m_wakeup.SetEvent();
+            }
+        }
+
+        // After this returns the job is not running and will not run, unless revoked from its own Timed().
+        void Revoke(Job& job)
+        {
+            m_adminLock.Lock();
+
+            Unlink(job);
+            const bool running = (m_executing == &job) && (Core::Thread::ThreadId() != Id());
+
+            m_adminLock.Unlock();
+
+            if (running == true) {
+                m_dispatchLock.Lock();
+                m_dispatchLock.Unlock();
+            }
+        }
+
+    private:
+        static uint64_t Now()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        static uint8_t Shift(const uint8_t level)
+        {
+            return (level * SlotBits);
+        }
+
+        uint32_t Worker() override
+        {
+            m_adminLock.Lock();
+
+            const uint64_t now = Now();
+            Advance(now);
+
+            Job* job = m_heads[Expired];
+
+            if (job != nullptr) {
+                Unlink(*job);
+                m_executing = job;
+
+                // taken before the admin lock is released, so Revoke() can not miss a running job
+                m_dispatchLock.Lock();
+                m_adminLock.Unlock();
+
+                job->Timed();
+
+                m_adminLock.Lock();
+                m_executing = nullptr;
+                m_adminLock.Unlock();
+                m_dispatchLock.Unlock();
+            } else {
+                m_nextWakeup = NextEvent();
+                m_wakeup.ResetEvent();
+
+                m_adminLock.Unlock();
+
+                m_wakeup.Lock(m_nextWakeup == Never ? Core::infinite : static_cast<uint32_t>(std::min<uint64_t>(m_nextWakeup - now, Core::infinite - 1)));
+            }
+
+            return (0);
+        }
+
+        void Link(const uint16_t list, Job& job)
+        {
+            job.m_list = list;
+            job.m_prev = nullptr;
+            job.m_next = nullptr;
+
+            if (list == Expired) {
+                // keep expired jobs in expiry order
+                job.m_prev = m_expiredTail;
+                if (m_expiredTail != nullptr) {
+                    m_expiredTail->m_next = &job;
+                } else {
+                    m_heads[Expired] = &job;
+                }
+                m_expiredTail = &job;
+            } else {
+                job.m_next = m_heads[list];
+                if (job.m_next != nullptr) {
+                    job.m_next->m_prev = &job;
+                }
+                m_heads[list] = &job;
+                m_occupied[list / Slots] |= (static_cast<uint64_t>(1) << (list % Slots));
+            }
+        }
+        void Unlink(Job& job)
+        {
+            if (job.m_list == Unlinked) {
+                return;
+            }
+
+            if (job.m_prev != nullptr) {
+                job.m_prev->m_next = job.m_next;
+            } else {
+                m_heads[job.m_list] = job.m_next;
+            }
+            if (job.m_next != nullptr) {
+                job.m_next->m_prev = job.m_prev;
+            } else if (job.m_list == Expired) {
+                m_expiredTail = job.m_prev;
+            }
+
+            if ((job.m_list != Expired) && (m_heads[job.m_list] == nullptr)) {
+                m_occupied[job.m_list / Slots] &= ~(static_cast<uint64_t>(1) << (job.m_list % Slots));
+            }
+
+            job.m_prev = nullptr;
+            job.m_next = nullptr;
+            job.m_list = Unlinked;
+        }
+        // Files the job in the lowest level whose span covers its remaining time.
+        void File(Job& job)
+        {
+            if (job.m_expiry <= m_now) {
+                Link(Expired, job);
+                return;
+            }
+
+            const uint64_t delta = job.m_expiry - m_now;
+            uint8_t level = 0;
+
+            while ((level < (Levels - 1)) && (delta >= (static_cast<uint64_t>(1) << Shift(level + 1)))) {
+                ++level;
+            }
+
+            uint64_t slot = (job.m_expiry >> Shift(level));
+            if (delta >= (static_cast<uint64_t>(1) << Shift(Levels))) {
+                // beyond the wheel, park it in the last slot of the top level to be re-filed from there
+                slot = (m_now >> Shift(level)) + (Slots - 1);
+            }
+
+            Link(static_cast<uint16_t>((level * Slots) + (slot % Slots)), job);
+        }
+        // The next tick at which a job expires or a non-empty slot has to be cascaded down.
+        uint64_t NextEvent() const
+        {
+            uint64_t result = Never;
+
+            for (uint8_t level = 0; level < Levels; ++level) {
+                if (m_occupied[level] == 0) {
+                    continue;
+                }
+
+                const uint64_t position = (m_now >> Shift(level));
+                const uint8_t current = static_cast<uint8_t>(position % Slots);
+                // rotate so bit 0 is the slot after the current one, the current slot itself is a full turn away
+                const uint8_t rotation = static_cast<uint8_t>((current + 1) % Slots);
+                const uint64_t mask = (rotation == 0) ? m_occupied[level] : ((m_occupied[level] >> rotation) | (m_occupied[level] << (Slots - rotation)));
+                const uint64_t distance = static_cast<uint64_t>(__builtin_ctzll(mask)) + 1;
+                const uint64_t tick = (position + distance) << Shift(level);
+
+                result = std::min(result, tick);
+            }
+
+            return (result);
+        }
+        // Moves the wheel forward to now, cascading higher levels down and collecting expired jobs.
+        void Advance(const uint64_t now)
+        {
+            uint64_t tick;
+
+            while (((tick = NextEvent()) != Never) && (tick <= now)) {
+                m_now = tick;
+
+                uint8_t top = 1;
+                while ((top < Levels) && ((m_now & ((static_cast<uint64_t>(1) << Shift(top)) - 1)) == 0)) {
+                    ++top;
+                }
+                for (uint8_t level = top - 1; level > 0; --level) {
+                    Cascade(static_cast<uint16_t>((level * Slots) + ((m_now >> Shift(level)) % Slots)));
+                }
+                Cascade(static_cast<uint16_t>(m_now % Slots));
+            }
+
+            if (now > m_now) {
+                m_now = now;
+            }
+        }
+        void Cascade(const uint16_t list)
+        {
+            Job* job = m_heads[list];
+
+            while (job != nullptr) {
+                Job* next = job->m_next;
+                Unlink(*job);
+                File(*job);
+                job = next;
+            }
+        }
+
+    private:
+        Core::CriticalSection m_adminLock;
+        Core::CriticalSection m_dispatchLock;
+        Core::Event m_wakeup;
+        Job* m_heads[Unlinked];
+        uint64_t m_occupied[Levels];
+        Job* m_expiredTail;
+        uint64_t m_now;
+        uint64_t m_nextWakeup;
+        Job* m_executing;
+    };
+
     class TpTimer {
     private:
-        class TpTimerJob {
+        class TpTimerJob : public TpTimerService::Job {
         private:
             TpTimerJob() = delete;
             TpTimerJob& operator=(const TpTimerJob& RHS) = delete;
@@ -38,24 +332,14 @@ namespace Plugin {
                 : m_tptimer(tpt)
             {
             }
-            TpTimerJob(const TpTimerJob& copy)
-                : m_tptimer(copy.m_tptimer)
-            {
-            }
-            ~TpTimerJob() {}
-
-            inline bool operator==(const TpTimerJob& RHS) const
-            {
-                return (m_tptimer == RHS.m_tptimer);
-            }
+            ~TpTimerJob() override {}
 
         public:
-            uint64_t Timed(const uint64_t scheduledTime)
+            void Timed() override
             {
                 if (m_tptimer) {
                     m_tptimer->Timed();
                 }
-                return 0;
             }
 
         private:
@@ -64,7 +348,7 @@ namespace Plugin {
 
     public:
         TpTimer()
-            : baseTimer(64 * 1024, "ThunderPluginBaseTimer")
+            : baseTimer(TpTimerService::Instance())
             , m_timerJob(this)
             , m_isActive(false)
             , m_isSingleShot(false)
@@ -87,8 +371,7 @@ namespace Plugin {
         }
         void start()
         {
-            baseTimer.Revoke(m_timerJob);
-            baseTimer.Schedule(Core::Time::Now().Add(m_intervalInMs), m_timerJob);
+            baseTimer.Schedule(m_timerJob, static_cast<uint32_t>(m_intervalInMs));
             m_isActive = true;
         }
         void start(int msec)
@@ -126,7 +409,8 @@ namespace Plugin {
             }
         }
 
-        WPEFramework::Core::TimerType<TpTimerJob> baseTimer;
+        // shared by all timers, obtained in the constructor so it outlives every static TpTimer
+        TpTimerService& baseTimer;
         TpTimerJob m_timerJob;
         bool m_isActive;
         bool m_isSingleShot;